@@ -0,0 +1,100 @@
+#pragma once
+// 基准测试使用的对数-线性直方图，与HdrHistogram的分桶方式相同
+// 每个2的幂区间再均分为kSubBuckets/2个子桶，相对误差不超过1/(kSubBuckets/2)，约0.8%
+// 记录只做一次数组自增，不加锁，每个线程使用自己的直方图，结束后merge
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class HdrHistogram
+{
+public:
+    static const int kSubBucketBits = 8;
+    static const int64_t kSubBuckets = 1 << kSubBucketBits;
+    static const int64_t kHalf = kSubBuckets / 2;
+    static const int kIndexes = kSubBuckets + (64 - kSubBucketBits) * kHalf;
+
+    HdrHistogram() : counts_(kIndexes, 0), count_(0), sum_(0), min_(INT64_MAX), max_(0) {}
+
+    void record(int64_t value)
+    {
+        if (value < 0) value = 0;
+        ++counts_[indexOf(value)];
+        ++count_;
+        sum_ += static_cast<double>(value);
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+
+    void merge(const HdrHistogram &other)
+    {
+        for (int i = 0; i < kIndexes; ++i) counts_[i] += other.counts_[i];
+        count_ += other.count_;
+        sum_ += other.sum_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    void reset() { *this = HdrHistogram(); }
+
+    uint64_t count() const { return count_; }
+    int64_t min() const { return count_ == 0 ? 0 : min_; }
+    int64_t max() const { return max_; }
+    double mean() const { return count_ == 0 ? 0.0 : sum_ / count_; }
+
+    // 第p百分位（0~100）的值，返回所在子桶的上界，不超过实际最大值
+    int64_t percentile(double p) const
+    {
+        if (count_ == 0) return 0;
+        uint64_t target = static_cast<uint64_t>(p / 100.0 * count_ + 0.5);
+        if (target < 1) target = 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < kIndexes; ++i)
+        {
+            seen += counts_[i];
+            if (seen >= target) return std::min(highestEquivalent(i), max_);
+        }
+        return max_;
+    }
+
+    // 以JSON对象输出常用的百分位，value / divisor为输出的单位
+    std::string toJson(double divisor) const
+    {
+        char buf[512];
+        snprintf(buf, sizeof(buf),
+                 "{\"count\":%llu,\"min\":%.3f,\"mean\":%.3f,\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,"
+                 "\"p99.9\":%.3f,\"p99.99\":%.3f,\"max\":%.3f}",
+                 static_cast<unsigned long long>(count_), min() / divisor, mean() / divisor,
+                 percentile(50) / divisor, percentile(90) / divisor, percentile(99) / divisor,
+                 percentile(99.9) / divisor, percentile(99.99) / divisor, max() / divisor);
+        return buf;
+    }
+
+private:
+    // 小于kSubBuckets的值每个值一个桶，更大的值按最高位的位置分组，组内取紧随最高位的kSubBucketBits-1位
+    static int indexOf(int64_t value)
+    {
+        uint64_t v = static_cast<uint64_t>(value);
+        if (v < static_cast<uint64_t>(kSubBuckets)) return static_cast<int>(v);
+        int msb = 63 - __builtin_clzll(v);
+        int shift = msb - (kSubBucketBits - 1);
+        int top = static_cast<int>(v >> shift);   // [kHalf, kSubBuckets)
+        return static_cast<int>(kSubBuckets + (shift - 1) * kHalf + (top - kHalf));
+    }
+
+    static int64_t highestEquivalent(int index)
+    {
+        if (index < kSubBuckets) return index;
+        int shift = (index - kSubBuckets) / kHalf + 1;
+        int64_t top = (index - kSubBuckets) % kHalf + kHalf;
+        return ((top + 1) << shift) - 1;
+    }
+
+    std::vector<uint64_t> counts_;
+    uint64_t count_;
+    double sum_;
+    int64_t min_;
+    int64_t max_;
+};
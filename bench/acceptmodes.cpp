@@ -0,0 +1,133 @@
+// 比较TcpServer三种accept方式的建连速率和尾延迟
+// 每个客户端线程循环执行：connect -> 发送1字节 -> 收到回显 -> close，记录每次的耗时
+// 用法：在bench目录下运行 ./acceptmodes [subloop数] [客户端线程数] [每种方式的运行秒数]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "EventLoop.hpp"
+#include "EventLoopThread.hpp"
+#include "TcpServer.hpp"
+#include "MyLog.hpp"
+
+ThreadPool *tp = nullptr;
+
+using Clock = std::chrono::steady_clock;
+
+// 建立一次连接并完成一次1字节的往返，返回是否成功
+static bool connectOnce(uint16_t port)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    bool ok = false;
+    char c = 'x';
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0 &&
+        ::write(fd, &c, 1) == 1 && ::read(fd, &c, 1) == 1)
+    {
+        ok = true;
+    }
+    ::close(fd);
+    return ok;
+}
+
+static double percentile(const std::vector<int64_t> &sorted, double p)
+{
+    if (sorted.empty()) return 0;
+    size_t idx = static_cast<size_t>(p * (sorted.size() - 1));
+    return sorted[idx] / 1000.0;
+}
+
+static void runMode(const char *name, TcpServer::AcceptMode mode, uint16_t port,
+                    int loops, int clients, double seconds)
+{
+    EventLoopThread baseThread;
+    EventLoop *baseLoop = baseThread.startLoop();
+
+    // TcpServer需要在baseLoop所在的线程中创建和销毁
+    TcpServer *server = nullptr;
+    std::promise<void> started;
+    baseLoop->runInLoop([&] {
+        server = new TcpServer(baseLoop, InetAddress(port), name, TcpServer::KReusePort);
+        server->setThreadNum(loops);
+        server->setAcceptMode(mode);
+        server->setConnectionCallback([](const TcpConnectionPtr &) {});
+        server->setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) { conn->send(buf); });
+        server->start();
+        started.set_value();
+    });
+    started.get_future().wait();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::vector<std::vector<int64_t>> latencies(clients);
+    std::atomic<uint64_t> failures{0};
+    auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    auto begin = Clock::now();
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < clients; ++i)
+    {
+        threads.emplace_back([&, i] {
+            while (Clock::now() < deadline)
+            {
+                auto start = Clock::now();
+                if (!connectOnce(port))
+                {
+                    failures.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                latencies[i].push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+            }
+        });
+    }
+    for (auto &t : threads) t.join();
+    double elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+
+    std::promise<void> stopped;
+    baseLoop->runInLoop([&] {
+        delete server;
+        stopped.set_value();
+    });
+    stopped.get_future().wait();
+
+    std::vector<int64_t> all;
+    for (auto &v : latencies) all.insert(all.end(), v.begin(), v.end());
+    std::sort(all.begin(), all.end());
+    printf("%-20s %10.0f %9.1f %9.1f %9.1f %9.1f %8lu\n", name, all.size() / elapsed,
+           percentile(all, 0.5), percentile(all, 0.99), percentile(all, 0.999),
+           all.empty() ? 0.0 : all.back() / 1000.0, static_cast<unsigned long>(failures.load()));
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+    int loops = argc > 1 ? atoi(argv[1]) : 4;
+    int clients = argc > 2 ? atoi(argv[2]) : 8;
+    double seconds = argc > 3 ? atof(argv[3]) : 5.0;
+
+    tp = new ThreadPool(1);
+    std::shared_ptr<mylog::LoggerBuilder> Glb(new mylog::LoggerBuilder());
+    Glb->BuildLoggerName("asynclogger");
+    Glb->BuildLoggerFlush<mylog::FileFlush>("./acceptmodes.log");
+    mylog::LoggerManager::GetInstance().AddLogger(Glb->Build());
+
+    printf("loops=%d clients=%d seconds=%.1f\n", loops, clients, seconds);
+    printf("%-20s %10s %9s %9s %9s %9s %8s\n", "mode", "conn/s", "p50(us)", "p99(us)", "p999(us)", "max(us)", "failed");
+    runMode("single-acceptor", TcpServer::kSingleAcceptor, 9301, loops, clients, seconds);
+    runMode("reuseport-per-loop", TcpServer::kReusePortPerLoop, 9302, loops, clients, seconds);
+    runMode("shared-exclusive", TcpServer::kSharedListener, 9303, loops, clients, seconds);
+    return 0;
+}
@@ -0,0 +1,364 @@
+// HttpServer的wrk风格压测：固定数量的keep-alive连接，每个连接保持depth个pipelined请求在途，
+// 收到完整响应后立即发送下一个请求，统计请求速率、传输速率和延迟分布
+// 客户端同样基于TcpClient和EventLoop，结果以一行JSON输出到stdout，可读的摘要输出到stderr
+// 用法：在bench目录下运行 ./httpbench [-c 连接数] [-t 客户端loop数] [-T 服务端subloop数] [-p pipeline深度]
+//       [-d 测量秒数] [-w 预热秒数] [-b 内置服务端的响应体字节数] [-u 请求路径] [-a ip:port 压测外部服务] [-e 边沿触发]
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "EventLoop.hpp"
+#include "EventLoopThread.hpp"
+#include "HttpServer.hpp"
+#include "TcpClient.hpp"
+#include "MyLog.hpp"
+#include "HdrHistogram.hpp"
+
+// 被测库的编译选项，由Makefile传入并写入每行JSON，区分调试构建和优化构建的结果
+#ifndef BENCH_LIB_CXXFLAGS
+#define BENCH_LIB_CXXFLAGS "unknown"
+#endif
+
+ThreadPool *tp = nullptr;
+
+namespace
+{
+struct Options
+{
+    int connections = 32;
+    int clientThreads = 1;
+    int serverThreads = 1;
+    int depth = 1;
+    double duration = 5;
+    double warmup = 1;
+    size_t bodySize = 64;
+    std::string path = "/";
+    std::string ip = "127.0.0.1";
+    uint16_t port = 9410;
+    bool external = false;
+    bool edgeTriggered = false;
+};
+
+int64_t nowNs()
+{
+    return Timestamp::monotonic().nanoseconds();
+}
+
+struct Worker;
+
+// 一个客户端连接，只在所属worker的loop线程中访问
+struct Session
+{
+    Worker *worker;
+    std::unique_ptr<TcpClient> client;
+    TcpConnectionPtr conn;
+    std::deque<int64_t> inflight;   // 在途请求的发送时刻
+};
+
+struct Worker
+{
+    EventLoop *loop;
+    std::vector<std::unique_ptr<Session>> sessions;
+    HdrHistogram latency;   // 纳秒
+    uint64_t responses = 0;
+    uint64_t bytes = 0;
+    uint64_t errors = 0;    // 非2xx响应
+    bool measuring = false;
+    bool stopping = false;
+};
+
+// 解析buf开头的一个响应，完整时返回响应的总长度，不完整时返回0，格式错误时返回-1
+long parseResponse(std::string_view buf, int *status)
+{
+    size_t headerEnd = buf.find("\r\n\r\n");
+    if (headerEnd == std::string_view::npos) return 0;
+    if (buf.size() < 12 || buf.compare(0, 5, "HTTP/") != 0) return -1;
+    *status = atoi(buf.data() + 9);
+
+    size_t contentLength = 0;
+    std::string_view head = buf.substr(0, headerEnd + 2);
+    for (size_t line = head.find("\r\n") + 2; line < head.size();)
+    {
+        size_t lineEnd = head.find("\r\n", line);
+        std::string_view field = head.substr(line, lineEnd - line);
+        if (field.size() > 15 && HttpRequest::equalsIgnoreCase(field.substr(0, 15), "Content-Length:"))
+        {
+            contentLength = strtoul(field.data() + 15, nullptr, 10);
+        }
+        line = lineEnd + 2;
+    }
+    size_t total = headerEnd + 4 + contentLength;
+    return buf.size() >= total ? static_cast<long>(total) : 0;
+}
+
+class Bench
+{
+public:
+    explicit Bench(const Options &options)
+        : options_(options),
+          request_("GET " + options.path + " HTTP/1.1\r\nHost: " + options.ip + "\r\nUser-Agent: httpbench\r\n\r\n"),
+          connected_(0)
+    {
+    }
+
+    void run()
+    {
+        std::vector<std::unique_ptr<EventLoopThread>> threads;
+        std::vector<std::unique_ptr<Worker>> workers;
+        for (int i = 0; i < options_.clientThreads; ++i)
+        {
+            threads.emplace_back(new EventLoopThread(EventLoopThread::ThreadInitCallback(), "bench-client"));
+            workers.emplace_back(new Worker);
+            workers.back()->loop = threads.back()->startLoop();
+        }
+
+        InetAddress serverAddr(options_.port, options_.ip);
+        for (int i = 0; i < options_.connections; ++i)
+        {
+            Worker *worker = workers[i % workers.size()].get();
+            worker->loop->runInLoop([this, worker, serverAddr] { connect(worker, serverAddr); });
+        }
+        for (int waited = 0; connected_.load() < options_.connections; ++waited)
+        {
+            if (waited == 1000)
+            {
+                fprintf(stderr, "only %d of %d connections established\n", connected_.load(), options_.connections);
+                exit(1);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        forEachWorker(workers, [this](Worker *worker)
+        {
+            for (auto &session : worker->sessions)
+            {
+                for (int i = 0; i < options_.depth; ++i) send(session.get());
+            }
+        });
+        std::this_thread::sleep_for(std::chrono::duration<double>(options_.warmup));
+        forEachWorker(workers, [](Worker *worker) { worker->measuring = true; });
+        int64_t begin = nowNs();
+        std::this_thread::sleep_for(std::chrono::duration<double>(options_.duration));
+        HdrHistogram latency;
+        uint64_t responses = 0, bytes = 0, errors = 0;
+        forEachWorker(workers, [&](Worker *worker)
+        {
+            worker->measuring = false;
+            worker->stopping = true;
+            latency.merge(worker->latency);
+            responses += worker->responses;
+            bytes += worker->bytes;
+            errors += worker->errors;
+        });
+        double elapsed = (nowNs() - begin) / 1e9;
+
+        // TcpClient需要在所属的loop线程中销毁，销毁时关闭的连接之后还会回调，先换掉引用Session的回调
+        forEachWorker(workers, [](Worker *worker)
+        {
+            for (auto &session : worker->sessions)
+            {
+                if (!session->conn) continue;
+                session->conn->setConnectionCallback([](const TcpConnectionPtr &) {});
+                session->conn->setMessageCallback([](const TcpConnectionPtr &, Buffer *buf, Timestamp) { buf->retrieveAll(); });
+            }
+            worker->sessions.clear();
+        });
+        for (int i = 0; i < 2; ++i) forEachWorker(workers, [](Worker *) {});
+        threads.clear();
+
+        double rps = responses / elapsed;
+        printf("{\"lib_cxxflags\":\"%s\",\"connections\":%d,\"client_threads\":%d,\"server_threads\":%d,\"depth\":%d,\"path\":\"%s\","
+               "\"edge_triggered\":%s,\"duration\":%.3f,\"requests\":%llu,\"non_2xx\":%llu,"
+               "\"requests_per_sec\":%.1f,\"transfer_mb_per_sec\":%.3f,\"latency_us\":%s}\n",
+               BENCH_LIB_CXXFLAGS, options_.connections, options_.clientThreads, options_.external ? 0 : options_.serverThreads,
+               options_.depth, options_.path.c_str(), options_.edgeTriggered ? "true" : "false", elapsed,
+               static_cast<unsigned long long>(responses), static_cast<unsigned long long>(errors),
+               rps, bytes / elapsed / (1024 * 1024), latency.toJson(1000).c_str());
+        fflush(stdout);
+        fprintf(stderr, "%d connections, depth %d: %.0f requests/sec, %.2f MB/sec, latency p50=%.1fus p99=%.1fus max=%.1fus, non-2xx %llu\n",
+                options_.connections, options_.depth, rps, bytes / elapsed / (1024 * 1024),
+                latency.percentile(50) / 1e3, latency.percentile(99) / 1e3, latency.max() / 1e3,
+                static_cast<unsigned long long>(errors));
+    }
+
+private:
+    template <typename Fn>
+    static void forEachWorker(const std::vector<std::unique_ptr<Worker>> &workers, Fn fn)
+    {
+        for (auto &worker : workers)
+        {
+            std::promise<void> done;
+            Worker *w = worker.get();
+            w->loop->runInLoop([w, &fn, &done]
+            {
+                fn(w);
+                done.set_value();
+            });
+            done.get_future().wait();
+        }
+    }
+
+    void connect(Worker *worker, const InetAddress &serverAddr)
+    {
+        Session *session = new Session;
+        session->worker = worker;
+        worker->sessions.emplace_back(session);
+        session->client.reset(new TcpClient(worker->loop, serverAddr, "httpbench"));
+        session->client->setEdgeTriggered(options_.edgeTriggered);
+        session->client->setConnectionCallback([this, session](const TcpConnectionPtr &conn)
+        {
+            if (conn->connected())
+            {
+                conn->setTcpNoDelay(true);
+                session->conn = conn;
+                connected_.fetch_add(1);
+            }
+            else
+            {
+                session->conn.reset();
+            }
+        });
+        session->client->setMessageCallback([this, session](const TcpConnectionPtr &, Buffer *buf, Timestamp)
+        {
+            onMessage(session, buf);
+        });
+        session->client->connect();
+    }
+
+    void send(Session *session)
+    {
+        if (!session->conn) return;
+        session->inflight.push_back(nowNs());
+        session->conn->send(request_);
+    }
+
+    void onMessage(Session *session, Buffer *buf)
+    {
+        Worker *worker = session->worker;
+        int64_t now = nowNs();
+        // 本次读到的所有响应对应的下一批请求合并为一次writev
+        if (session->conn) session->conn->cork();
+        for (;;)
+        {
+            int status = 0;
+            long length = parseResponse(std::string_view(buf->peek(), buf->readableBytes()), &status);
+            if (length == 0) break;
+            if (length < 0 || session->inflight.empty())
+            {
+                fprintf(stderr, "malformed response\n");
+                exit(1);
+            }
+            int64_t sent = session->inflight.front();
+            session->inflight.pop_front();
+            buf->retrieve(length);
+            if (worker->measuring)
+            {
+                worker->latency.record(now - sent);
+                ++worker->responses;
+                worker->bytes += length;
+                if (status < 200 || status >= 300) ++worker->errors;
+            }
+            if (!worker->stopping) send(session);
+        }
+        if (session->conn) session->conn->uncork();
+    }
+
+    const Options &options_;
+    const std::string request_;
+    std::atomic<int> connected_;
+};
+
+void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-c conns] [-t client loops] [-T server loops] [-p depth] [-d seconds]\n"
+                    "          [-w warmup seconds] [-b body bytes] [-u path] [-a ip:port] [-e]\n", prog);
+    exit(2);
+}
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    int opt;
+    while ((opt = getopt(argc, argv, "c:t:T:p:d:w:b:u:a:e")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c': options.connections = atoi(optarg); break;
+        case 't': options.clientThreads = atoi(optarg); break;
+        case 'T': options.serverThreads = atoi(optarg); break;
+        case 'p': options.depth = atoi(optarg); break;
+        case 'd': options.duration = atof(optarg); break;
+        case 'w': options.warmup = atof(optarg); break;
+        case 'b': options.bodySize = static_cast<size_t>(atol(optarg)); break;
+        case 'u': options.path = optarg; break;
+        case 'a':
+        {
+            const char *colon = strrchr(optarg, ':');
+            if (colon == nullptr) usage(argv[0]);
+            options.ip.assign(optarg, colon - optarg);
+            options.port = static_cast<uint16_t>(atoi(colon + 1));
+            options.external = true;
+            break;
+        }
+        case 'e': options.edgeTriggered = true; break;
+        default: usage(argv[0]);
+        }
+    }
+    if (options.connections < 1 || options.clientThreads < 1 || options.depth < 1) usage(argv[0]);
+
+    tp = new ThreadPool(1);
+    std::shared_ptr<mylog::LoggerBuilder> Glb(new mylog::LoggerBuilder());
+    Glb->BuildLoggerName("asynclogger");
+    Glb->BuildLoggerFlush<mylog::FileFlush>("./httpbench.log");
+    mylog::LoggerManager::GetInstance().AddLogger(Glb->Build());
+
+    // 内置服务端对所有路径返回同一个共享的响应体，HttpServer需要在baseLoop所在的线程中创建和销毁
+    EventLoopThread serverThread(EventLoopThread::ThreadInitCallback(), "bench-server");
+    EventLoop *serverLoop = nullptr;
+    std::unique_ptr<HttpServer> server;
+    if (!options.external)
+    {
+        auto body = std::make_shared<const std::string>(options.bodySize, 'x');
+        serverLoop = serverThread.startLoop();
+        std::promise<void> started;
+        serverLoop->runInLoop([&]
+        {
+            server.reset(new HttpServer(serverLoop, InetAddress(options.port, options.ip), "httpbench-server"));
+            server->setThreadNum(options.serverThreads);
+            server->tcpServer().setEdgeTriggered(options.edgeTriggered);
+            server->setHttpCallback([body](const HttpRequest &, HttpResponse *resp)
+            {
+                resp->setContentType("text/plain");
+                resp->setBody(body);
+            });
+            server->start();
+            started.set_value();
+        });
+        started.get_future().wait();
+    }
+
+    Bench bench(options);
+    bench.run();
+
+    if (server)
+    {
+        std::promise<void> stopped;
+        serverLoop->runInLoop([&]
+        {
+            server.reset();
+            stopped.set_value();
+        });
+        stopped.get_future().wait();
+    }
+    return 0;
+}
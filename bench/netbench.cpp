@@ -0,0 +1,420 @@
+// 网络栈负载生成器，客户端与服务端使用同样的EventLoop、TcpClient和TcpConnection
+// pingpong：闭环，每个连接保持depth个消息在途，收到完整回显后立即发送下一个，测量吞吐和往返延迟
+// latency：开环，所有连接合计以固定速率发送，延迟从计划发送时刻开始计算（修正coordinated omission），
+//          服务端变慢时积压的请求也计入延迟，同时输出从实际发送时刻计算的未修正延迟作为对比
+// 每个(连接数, 消息大小)组合运行一次，向stdout输出一行JSON，可读的摘要输出到stderr
+// 用法：在bench目录下运行 ./netbench [-m pingpong|latency] [-c 连接数,...] [-s 消息字节数,...]
+//       [-t 客户端loop数] [-T 服务端subloop数] [-p 每连接在途消息数] [-r 每秒消息数]
+//       [-d 测量秒数] [-w 预热秒数] [-a ip:port 压测外部回显服务，不启动内置服务端] [-e 边沿触发]
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "EventLoop.hpp"
+#include "EventLoopThread.hpp"
+#include "TcpServer.hpp"
+#include "TcpClient.hpp"
+#include "MyLog.hpp"
+#include "HdrHistogram.hpp"
+
+// 被测库的编译选项，由Makefile传入并写入每行JSON，区分调试构建和优化构建的结果
+#ifndef BENCH_LIB_CXXFLAGS
+#define BENCH_LIB_CXXFLAGS "unknown"
+#endif
+
+ThreadPool *tp = nullptr;
+
+namespace
+{
+struct Options
+{
+    bool latencyMode = false;
+    std::vector<int> connections{16};
+    std::vector<int> sizes{64};
+    int clientThreads = 1;
+    int serverThreads = 1;
+    int depth = 1;
+    double rate = 20000;    // latency模式下所有连接合计每秒发送的消息数
+    double duration = 5;
+    double warmup = 1;
+    std::string ip = "127.0.0.1";
+    uint16_t port = 9400;
+    bool external = false;
+    bool edgeTriggered = false;
+};
+
+int64_t nowNs()
+{
+    return Timestamp::monotonic().nanoseconds();
+}
+
+struct Worker;
+
+// 一个客户端连接，只在所属worker的loop线程中访问
+struct Session
+{
+    Worker *worker;
+    std::unique_ptr<TcpClient> client;
+    TcpConnectionPtr conn;
+    std::deque<std::pair<int64_t, int64_t>> inflight;  // 每个在途消息的(计划发送时刻, 实际发送时刻)
+    size_t pending = 0;     // 已收到但还不够一个完整消息的字节数
+    int64_t nextSend = 0;   // latency模式下一个消息的计划发送时刻
+    int64_t interval = 0;
+    TimerId timer;
+    bool timerPending = false;
+};
+
+// 一个客户端loop及其上的连接和统计，统计只在loop线程中写入，结束后在loop线程中取出
+struct Worker
+{
+    EventLoop *loop;
+    int index;
+    std::vector<std::unique_ptr<Session>> sessions;
+    HdrHistogram latency;       // 纳秒
+    HdrHistogram uncorrected;
+    uint64_t messages = 0;
+    bool measuring = false;
+    bool stopping = false;
+};
+
+struct Result
+{
+    HdrHistogram latency;
+    HdrHistogram uncorrected;
+    uint64_t messages = 0;
+};
+
+class Bench
+{
+public:
+    Bench(const Options &options, int connections, int size)
+        : options_(options),
+          connections_(connections),
+          size_(static_cast<size_t>(size)),
+          payload_(std::make_shared<const std::string>(size, 'x')),
+          connected_(0)
+    {
+    }
+
+    void run()
+    {
+        std::vector<std::unique_ptr<EventLoopThread>> threads;
+        std::vector<std::unique_ptr<Worker>> workers;
+        for (int i = 0; i < options_.clientThreads; ++i)
+        {
+            threads.emplace_back(new EventLoopThread(EventLoopThread::ThreadInitCallback(), "bench-client"));
+            workers.emplace_back(new Worker);
+            workers.back()->loop = threads.back()->startLoop();
+            workers.back()->index = i;
+        }
+
+        InetAddress serverAddr(options_.port, options_.ip);
+        for (int i = 0; i < connections_; ++i)
+        {
+            Worker *worker = workers[i % workers.size()].get();
+            worker->loop->runInLoop([this, worker, serverAddr] { connect(worker, serverAddr); });
+        }
+        for (int waited = 0; connected_.load() < connections_; ++waited)
+        {
+            if (waited == 1000)
+            {
+                fprintf(stderr, "only %d of %d connections established\n", connected_.load(), connections_);
+                exit(1);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        forEachWorker(workers, [this](Worker *worker) { startTraffic(worker); });
+        std::this_thread::sleep_for(std::chrono::duration<double>(options_.warmup));
+        forEachWorker(workers, [](Worker *worker) { worker->measuring = true; });
+        int64_t begin = nowNs();
+        std::this_thread::sleep_for(std::chrono::duration<double>(options_.duration));
+        Result result;
+        forEachWorker(workers, [&result](Worker *worker)
+        {
+            worker->measuring = false;
+            worker->stopping = true;
+            result.latency.merge(worker->latency);
+            result.uncorrected.merge(worker->uncorrected);
+            result.messages += worker->messages;
+        });
+        double elapsed = (nowNs() - begin) / 1e9;
+
+        // TcpClient需要在所属的loop线程中销毁，销毁时关闭的连接之后还会回调，先换掉引用Session的回调
+        forEachWorker(workers, [](Worker *worker)
+        {
+            for (auto &session : worker->sessions)
+            {
+                if (session->timerPending) worker->loop->cancel(session->timer);
+                if (!session->conn) continue;
+                session->conn->setConnectionCallback([](const TcpConnectionPtr &) {});
+                session->conn->setMessageCallback([](const TcpConnectionPtr &, Buffer *buf, Timestamp) { buf->retrieveAll(); });
+            }
+            worker->sessions.clear();
+        });
+        // 连接的关闭和销毁各需要一轮任务，等它们执行完再退出loop，避免连接在服务端残留到下一次运行
+        for (int i = 0; i < 2; ++i) forEachWorker(workers, [](Worker *) {});
+        threads.clear();
+        report(result, elapsed);
+    }
+
+private:
+    // 在每个worker的loop线程中执行fn，全部执行完后返回
+    template <typename Fn>
+    static void forEachWorker(const std::vector<std::unique_ptr<Worker>> &workers, Fn fn)
+    {
+        for (auto &worker : workers)
+        {
+            std::promise<void> done;
+            Worker *w = worker.get();
+            w->loop->runInLoop([w, &fn, &done]
+            {
+                fn(w);
+                done.set_value();
+            });
+            done.get_future().wait();
+        }
+    }
+
+    void connect(Worker *worker, const InetAddress &serverAddr)
+    {
+        Session *session = new Session;
+        session->worker = worker;
+        worker->sessions.emplace_back(session);
+        session->client.reset(new TcpClient(worker->loop, serverAddr, "bench"));
+        session->client->setEdgeTriggered(options_.edgeTriggered);
+        session->client->setConnectionCallback([this, session](const TcpConnectionPtr &conn)
+        {
+            if (conn->connected())
+            {
+                conn->setTcpNoDelay(true);
+                session->conn = conn;
+                connected_.fetch_add(1);
+            }
+            else
+            {
+                session->conn.reset();
+            }
+        });
+        session->client->setMessageCallback([this, session](const TcpConnectionPtr &, Buffer *buf, Timestamp)
+        {
+            onMessage(session, buf);
+        });
+        session->client->connect();
+    }
+
+    void startTraffic(Worker *worker)
+    {
+        int64_t now = nowNs();
+        int index = 0;
+        for (auto &item : worker->sessions)
+        {
+            Session *session = item.get();
+            if (!options_.latencyMode)
+            {
+                for (int i = 0; i < options_.depth; ++i) send(session, now, now);
+                continue;
+            }
+            // 各连接的发送时刻错开，合计的发送速率保持均匀
+            session->interval = static_cast<int64_t>(connections_ * 1e9 / options_.rate);
+            // 第i个连接属于第i % clientThreads个worker
+            int global = index++ * options_.clientThreads + worker->index;
+            session->nextSend = now + session->interval * global / connections_;
+            tick(session);
+        }
+    }
+
+    void send(Session *session, int64_t intended, int64_t actual)
+    {
+        if (!session->conn) return;
+        session->inflight.emplace_back(intended, actual);
+        session->conn->send(payload_);
+    }
+
+    // 发送所有已到计划时刻的消息，再在下一个计划时刻唤醒
+    void tick(Session *session)
+    {
+        session->timerPending = false;
+        Worker *worker = session->worker;
+        if (worker->stopping) return;
+        int64_t now = nowNs();
+        while (session->nextSend <= now)
+        {
+            send(session, session->nextSend, now);
+            session->nextSend += session->interval;
+        }
+        double delay = (session->nextSend - nowNs()) / 1e9;
+        session->timer = worker->loop->runAfter(delay > 0 ? delay : 0, [this, session] { tick(session); });
+        session->timerPending = true;
+    }
+
+    void onMessage(Session *session, Buffer *buf)
+    {
+        session->pending += buf->readableBytes();
+        buf->retrieveAll();
+        Worker *worker = session->worker;
+        int64_t now = nowNs();
+        while (session->pending >= size_ && !session->inflight.empty())
+        {
+            session->pending -= size_;
+            std::pair<int64_t, int64_t> sent = session->inflight.front();
+            session->inflight.pop_front();
+            if (worker->measuring)
+            {
+                worker->latency.record(now - sent.first);
+                worker->uncorrected.record(now - sent.second);
+                ++worker->messages;
+            }
+            if (!options_.latencyMode && !worker->stopping) send(session, now, now);
+        }
+    }
+
+    void report(const Result &result, double elapsed) const
+    {
+        double msgsPerSec = result.messages / elapsed;
+        printf("{\"lib_cxxflags\":\"%s\",\"mode\":\"%s\",\"connections\":%d,\"size\":%zu,\"depth\":%d,\"client_threads\":%d,"
+               "\"server_threads\":%d,\"edge_triggered\":%s,\"duration\":%.3f,\"messages\":%llu,"
+               "\"msgs_per_sec\":%.1f,\"mb_per_sec\":%.3f",
+               BENCH_LIB_CXXFLAGS, options_.latencyMode ? "latency" : "pingpong", connections_, size_,
+               options_.latencyMode ? 0 : options_.depth, options_.clientThreads,
+               options_.external ? 0 : options_.serverThreads, options_.edgeTriggered ? "true" : "false",
+               elapsed, static_cast<unsigned long long>(result.messages),
+               msgsPerSec, msgsPerSec * size_ / (1024 * 1024));
+        if (options_.latencyMode)
+        {
+            printf(",\"target_rate\":%.1f,\"latency_us\":%s,\"uncorrected_latency_us\":%s}\n",
+                   options_.rate, result.latency.toJson(1000).c_str(), result.uncorrected.toJson(1000).c_str());
+        }
+        else
+        {
+            printf(",\"latency_us\":%s}\n", result.latency.toJson(1000).c_str());
+        }
+        fflush(stdout);
+
+        fprintf(stderr, "%-8s conns=%-5d size=%-7zu %10.0f msg/s %9.2f MB/s  p50=%.1fus p99=%.1fus p999=%.1fus max=%.1fus\n",
+                options_.latencyMode ? "latency" : "pingpong", connections_, size_, msgsPerSec,
+                msgsPerSec * size_ / (1024 * 1024), result.latency.percentile(50) / 1e3,
+                result.latency.percentile(99) / 1e3, result.latency.percentile(99.9) / 1e3,
+                result.latency.max() / 1e3);
+    }
+
+    const Options &options_;
+    const int connections_;
+    const size_t size_;
+    const std::shared_ptr<const std::string> payload_; // 所有连接共享，发送时不拷贝
+    std::atomic<int> connected_;
+};
+
+std::vector<int> parseList(const char *arg)
+{
+    std::vector<int> values;
+    for (const char *p = arg; *p != '\0';)
+    {
+        values.push_back(atoi(p));
+        const char *comma = strchr(p, ',');
+        if (comma == nullptr) break;
+        p = comma + 1;
+    }
+    return values;
+}
+
+void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-m pingpong|latency] [-c conns,...] [-s bytes,...] [-t client loops] [-T server loops]\n"
+                    "          [-p depth] [-r msgs/s] [-d seconds] [-w warmup seconds] [-a ip:port] [-e]\n", prog);
+    exit(2);
+}
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    int opt;
+    while ((opt = getopt(argc, argv, "m:c:s:t:T:p:r:d:w:a:e")) != -1)
+    {
+        switch (opt)
+        {
+        case 'm': options.latencyMode = strcmp(optarg, "latency") == 0; break;
+        case 'c': options.connections = parseList(optarg); break;
+        case 's': options.sizes = parseList(optarg); break;
+        case 't': options.clientThreads = atoi(optarg); break;
+        case 'T': options.serverThreads = atoi(optarg); break;
+        case 'p': options.depth = atoi(optarg); break;
+        case 'r': options.rate = atof(optarg); break;
+        case 'd': options.duration = atof(optarg); break;
+        case 'w': options.warmup = atof(optarg); break;
+        case 'a':
+        {
+            const char *colon = strrchr(optarg, ':');
+            if (colon == nullptr) usage(argv[0]);
+            options.ip.assign(optarg, colon - optarg);
+            options.port = static_cast<uint16_t>(atoi(colon + 1));
+            options.external = true;
+            break;
+        }
+        case 'e': options.edgeTriggered = true; break;
+        default: usage(argv[0]);
+        }
+    }
+    if (options.clientThreads < 1 || options.depth < 1 || options.rate <= 0) usage(argv[0]);
+
+    tp = new ThreadPool(1);
+    std::shared_ptr<mylog::LoggerBuilder> Glb(new mylog::LoggerBuilder());
+    Glb->BuildLoggerName("asynclogger");
+    Glb->BuildLoggerFlush<mylog::FileFlush>("./netbench.log");
+    mylog::LoggerManager::GetInstance().AddLogger(Glb->Build());
+
+    // 内置的回显服务端，TcpServer需要在baseLoop所在的线程中创建和销毁
+    EventLoopThread serverThread(EventLoopThread::ThreadInitCallback(), "bench-server");
+    EventLoop *serverLoop = nullptr;
+    std::unique_ptr<TcpServer> server;
+    if (!options.external)
+    {
+        serverLoop = serverThread.startLoop();
+        std::promise<void> started;
+        serverLoop->runInLoop([&]
+        {
+            server.reset(new TcpServer(serverLoop, InetAddress(options.port, options.ip), "bench-server"));
+            server->setThreadNum(options.serverThreads);
+            server->setEdgeTriggered(options.edgeTriggered);
+            server->setConnectionCallback([](const TcpConnectionPtr &conn)
+            {
+                if (conn->connected()) conn->setTcpNoDelay(true);
+            });
+            server->setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) { conn->send(buf); });
+            server->start();
+            started.set_value();
+        });
+        started.get_future().wait();
+    }
+
+    for (int connections : options.connections)
+    {
+        for (int size : options.sizes)
+        {
+            if (connections < 1 || size < 1) usage(argv[0]);
+            Bench bench(options, connections, size);
+            bench.run();
+        }
+    }
+
+    if (server)
+    {
+        std::promise<void> stopped;
+        serverLoop->runInLoop([&]
+        {
+            server.reset();
+            stopped.set_value();
+        });
+        stopped.get_future().wait();
+    }
+    return 0;
+}
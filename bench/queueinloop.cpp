@@ -0,0 +1,291 @@
+// queueInLoop微基准：比较std::function与InplaceFunction作为loop任务类型时的入队开销和堆分配次数，
+// 并以改造前的实现（互斥锁保护的std::vector<std::function>，每次入队都写eventfd唤醒）作为基线
+// 用法：在bench目录下运行 ./queueinloop [生产者线程数] [每个线程的任务数]
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include "EventLoop.hpp"
+#include "EventLoopThread.hpp"
+#include "MpscQueue.hpp"
+#include "InplaceFunction.hpp"
+#include "MyLog.hpp"
+
+// 替换了全局的operator new/delete，内联后编译器会误报new与free不匹配
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+ThreadPool *tp = nullptr;
+
+// 统计全局的堆分配次数
+static std::atomic<uint64_t> g_allocations{0};
+
+void *operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = std::malloc(size);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+// 模拟TcpConnection中常见的回调：成员函数 + shared_ptr + 一个参数
+struct Connection
+{
+    std::atomic<uint64_t> handled{0};
+    void handle(Timestamp) { handled.fetch_add(1, std::memory_order_relaxed); }
+};
+
+struct Result
+{
+    double nsPerTask;
+    double allocsPerTask;
+};
+
+// 生产者并发入队，一个消费者线程持续出队执行，测量只与任务类型有关的开销
+template <typename Task>
+Result runQueue(int producers, int tasksPerProducer)
+{
+    MpscQueue<Task> queue;
+    auto conn = std::make_shared<Connection>();
+    const uint64_t total = static_cast<uint64_t>(producers) * tasksPerProducer;
+
+    uint64_t allocsBefore = g_allocations.load();
+    auto start = std::chrono::steady_clock::now();
+
+    std::thread consumer([&] {
+        Task task;
+        uint64_t done = 0;
+        while (done < total)
+        {
+            if (queue.pop(task))
+            {
+                task();
+                task = nullptr;
+                ++done;
+            }
+        }
+    });
+    std::vector<std::thread> threads;
+    for (int i = 0; i < producers; ++i)
+    {
+        threads.emplace_back([&] {
+            Timestamp now = Timestamp::now();
+            for (int j = 0; j < tasksPerProducer; ++j)
+            {
+                queue.push(Task(std::bind(&Connection::handle, conn, now)));
+            }
+        });
+    }
+    for (auto &t : threads) t.join();
+    consumer.join();
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    uint64_t allocs = g_allocations.load() - allocsBefore;
+    return {std::chrono::duration<double, std::nano>(elapsed).count() / total,
+            static_cast<double>(allocs) / total};
+}
+
+// 改造前EventLoop的回调队列：queueInLoop加锁后拷贝std::function到vector，其他线程每次入队都写eventfd，
+// loop线程被唤醒后在锁内交换vector再逐个执行
+class LegacyLoop
+{
+public:
+    LegacyLoop()
+        : wakeupFd_(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+          epollFd_(::epoll_create1(EPOLL_CLOEXEC)),
+          quit_(false)
+    {
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = wakeupFd_;
+        ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeupFd_, &event);
+        thread_ = std::thread(&LegacyLoop::loop, this);
+    }
+
+    ~LegacyLoop()
+    {
+        quit_ = true;
+        wakeup();
+        thread_.join();
+        ::close(epollFd_);
+        ::close(wakeupFd_);
+    }
+
+    void queueInLoop(std::function<void()> cb)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            pendingFunctors_.emplace_back(cb);
+        }
+        wakeup();
+    }
+
+private:
+    void loop()
+    {
+        while (!quit_)
+        {
+            epoll_event event;
+            if (::epoll_wait(epollFd_, &event, 1, 10000) > 0)
+            {
+                uint64_t one;
+                ssize_t n = ::read(wakeupFd_, &one, sizeof(one));
+                (void)n;
+            }
+            std::vector<std::function<void()>> functors;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                functors.swap(pendingFunctors_);
+            }
+            for (const auto &functor : functors) functor();
+        }
+    }
+
+    void wakeup()
+    {
+        uint64_t one = 1;
+        ssize_t n = ::write(wakeupFd_, &one, sizeof(one));
+        (void)n;
+    }
+
+    const int wakeupFd_;
+    const int epollFd_;
+    std::atomic<bool> quit_;
+    std::mutex mutex_;
+    std::vector<std::function<void()>> pendingFunctors_;
+    std::thread thread_;
+};
+
+// 基线：通过LegacyLoop从其他线程投递任务，与runEventLoop的测量方式相同
+Result runLegacyLoop(int producers, int tasksPerProducer)
+{
+    LegacyLoop loop;
+    auto conn = std::make_shared<Connection>();
+    const uint64_t total = static_cast<uint64_t>(producers) * tasksPerProducer;
+
+    uint64_t allocsBefore = g_allocations.load();
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < producers; ++i)
+    {
+        threads.emplace_back([&] {
+            Timestamp now = Timestamp::now();
+            for (int j = 0; j < tasksPerProducer; ++j)
+            {
+                loop.queueInLoop(std::bind(&Connection::handle, conn, now));
+            }
+        });
+    }
+    for (auto &t : threads) t.join();
+    while (conn->handled.load(std::memory_order_relaxed) < total)
+    {
+        std::this_thread::yield();
+    }
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    uint64_t allocs = g_allocations.load() - allocsBefore;
+    return {std::chrono::duration<double, std::nano>(elapsed).count() / total,
+            static_cast<double>(allocs) / total};
+}
+
+// 通过EventLoop::queueInLoop从其他线程向loop投递任务，包括唤醒loop的开销
+Result runEventLoop(int producers, int tasksPerProducer)
+{
+    EventLoopThread loopThread;
+    EventLoop *loop = loopThread.startLoop();
+    auto conn = std::make_shared<Connection>();
+    const uint64_t total = static_cast<uint64_t>(producers) * tasksPerProducer;
+
+    uint64_t allocsBefore = g_allocations.load();
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < producers; ++i)
+    {
+        threads.emplace_back([&] {
+            Timestamp now = Timestamp::now();
+            for (int j = 0; j < tasksPerProducer; ++j)
+            {
+                loop->queueInLoop(std::bind(&Connection::handle, conn, now));
+            }
+        });
+    }
+    for (auto &t : threads) t.join();
+    while (conn->handled.load(std::memory_order_relaxed) < total)
+    {
+        std::this_thread::yield();
+    }
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    uint64_t allocs = g_allocations.load() - allocsBefore;
+    return {std::chrono::duration<double, std::nano>(elapsed).count() / total,
+            static_cast<double>(allocs) / total};
+}
+
+// loop线程自己调用queueInLoop，对应TcpConnection在loop内的续写、续读等任务
+Result runInLoopThread(int tasks)
+{
+    EventLoopThread loopThread;
+    EventLoop *loop = loopThread.startLoop();
+    auto conn = std::make_shared<Connection>();
+
+    uint64_t allocsBefore = g_allocations.load();
+    auto start = std::chrono::steady_clock::now();
+
+    loop->runInLoop([loop, conn, tasks] {
+        Timestamp now = Timestamp::now();
+        for (int j = 0; j < tasks; ++j)
+        {
+            loop->queueInLoop(std::bind(&Connection::handle, conn, now));
+        }
+    });
+    while (conn->handled.load(std::memory_order_relaxed) < static_cast<uint64_t>(tasks))
+    {
+        std::this_thread::yield();
+    }
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    uint64_t allocs = g_allocations.load() - allocsBefore;
+    return {std::chrono::duration<double, std::nano>(elapsed).count() / tasks,
+            static_cast<double>(allocs) / tasks};
+}
+
+int main(int argc, char *argv[])
+{
+    int producers = argc > 1 ? atoi(argv[1]) : 4;
+    int tasksPerProducer = argc > 2 ? atoi(argv[2]) : 200000;
+
+    tp = new ThreadPool(1);
+    std::shared_ptr<mylog::LoggerBuilder> Glb(new mylog::LoggerBuilder());
+    Glb->BuildLoggerName("asynclogger");
+    Glb->BuildLoggerFlush<mylog::FileFlush>("./queueinloop.log");
+    mylog::LoggerManager::GetInstance().AddLogger(Glb->Build());
+
+    Result legacy = runQueue<std::function<void()>>(producers, tasksPerProducer);
+    Result inplace = runQueue<EventLoop::Functor>(producers, tasksPerProducer);
+    Result baseline = runLegacyLoop(producers, tasksPerProducer);
+    Result loop = runEventLoop(producers, tasksPerProducer);
+    Result local = runInLoopThread(producers * tasksPerProducer);
+
+    printf("producers=%d tasks=%d\n", producers, producers * tasksPerProducer);
+    printf("%-28s %10s %14s\n", "path", "ns/task", "allocs/task");
+    printf("%-28s %10.1f %14.2f\n", "baseline mutex+vector", baseline.nsPerTask, baseline.allocsPerTask);
+    printf("%-28s %10.1f %14.2f\n", "MpscQueue<std::function>", legacy.nsPerTask, legacy.allocsPerTask);
+    printf("%-28s %10.1f %14.2f\n", "MpscQueue<Functor>", inplace.nsPerTask, inplace.allocsPerTask);
+    printf("%-28s %10.1f %14.2f\n", "queueInLoop (other thread)", loop.nsPerTask, loop.allocsPerTask);
+    printf("%-28s %10.2fx\n", "speedup vs baseline", baseline.nsPerTask / loop.nsPerTask);
+    printf("%-28s %10.1f %14.2f\n", "queueInLoop (loop thread)", local.nsPerTask, local.allocsPerTask);
+    return 0;
+}
@@ -1,5 +1,8 @@
 #pragma once
 #include <functional>
+#include <memory>
+#include <vector>
+#include <atomic>
 #include "noncopyable.hpp"
 #include "Channel.hpp"
 #include "Socket.hpp"
@@ -10,24 +13,75 @@ class Acceptor : noncopyable
 public:
     using NewConnectionCallback = std::function<void(int sockfd, const InetAddress&)>;
 
+    // 一次读事件中accept到的一个连接
+    struct AcceptedConnection
+    {
+        int sockfd;
+        InetAddress peerAddr;
+    };
+    using AcceptedList = std::vector<AcceptedConnection>;
+    // 一次读事件中accept到的所有连接一起交给上层处理
+    using NewConnectionBatchCallback = std::function<void(const AcceptedList&)>;
+
+    // accept统计，只由Acceptor所在的loop线程写入，其他线程可以随时读取
+    // 由shared_ptr持有，Acceptor销毁后TcpServer仍然可以读取
+    struct Stats
+    {
+        std::atomic<uint64_t> accepted{0};  // 交给上层的连接数
+        std::atomic<uint64_t> shed{0};      // 文件描述符耗尽时丢弃的连接数
+        std::atomic<uint64_t> errors{0};    // 其他accept错误
+        std::atomic<uint64_t> batches{0};   // 处理的读事件数
+    };
+
+    // 一次读事件中默认最多accept的连接数
+    static const int kDefaultAcceptBatch = 64;
+    // 没有预留fd可以丢弃连接时暂停accept的时间，单位为秒
+    static constexpr double kAcceptPauseSeconds = 0.1;
+
+    // 创建并绑定监听socket，reuseport为true时设置SO_REUSEPORT
     Acceptor(EventLoop* loop, const InetAddress &listenAddr, bool reuseport);
+    // 与其他Acceptor共享同一个已绑定的监听socket，各自在自己的loop中accept
+    Acceptor(EventLoop* loop, const std::shared_ptr<Socket> &listenSocket);
     ~Acceptor();
     // 设置处理新连接的回调函数
     void setNewConnectionCallback(const NewConnectionCallback &cb)
     {
         NewConnectionCallback_ = cb;
     }
+    // 设置批量处理新连接的回调函数，设置后代替NewConnectionCallback
+    void setNewConnectionBatchCallback(const NewConnectionBatchCallback &cb)
+    {
+        newConnectionBatchCallback_ = cb;
+    }
+    // 设置一次读事件中最多accept的连接数
+    void setAcceptBatch(int n) { acceptBatch_ = n > 0 ? n : 1; }
+    const std::shared_ptr<Stats> &stats() const { return stats_; }
+    // 多个loop共享监听socket时以EPOLLEXCLUSIVE注册，避免每个连接唤醒所有loop，需要在listen之前设置
+    void setExclusive(bool on) { acceptChannel_.setExclusive(on); }
     // 查看监听状态
     bool listenning() const {return listenning_;}
-    // 监听本地端口
+    // 监听本地端口，需要在loop所在的线程中调用
     void listen();
+    const std::shared_ptr<Socket> &socket() const { return acceptSocket_; }
 private:
     void handleRead(); // 处理新用户的连接, 如果有新用户连接会调用NewConnectionCallback成员
+    // 文件描述符耗尽时，释放预留的fd接受一个连接并立即关闭，使监听socket不再一直可读
+    bool shedConnection();
+    // 预留fd被其他线程占用时，监听socket会一直可读，暂停监听一段时间再恢复，避免loop空转
+    void pauseAccept();
+    void resumeAccept();
 
 private:
-    EventLoop* loop_;       // mainLoop
-    Socket acceptSocket_;   // 监听socket
+    EventLoop* loop_;       // 执行accept的loop
+    std::shared_ptr<Socket> acceptSocket_;   // 监听socket，共享监听模式下由多个Acceptor共同持有
     Channel acceptChannel_;  // 监听Channel
     NewConnectionCallback NewConnectionCallback_; // 处理新连接的回调函数, 该成员由TcpServer提供
+    NewConnectionBatchCallback newConnectionBatchCallback_; // 批量处理新连接的回调函数
     bool listenning_;       // 监听状态
+    int acceptBatch_;       // 一次读事件中最多accept的连接数
+    int idleFd_;            // 预留的fd，用于在EMFILE时丢弃连接
+    bool acceptPaused_;     // 因没有预留fd暂停了监听
+    TimerId resumeTimer_;   // 恢复监听的定时器
+    AcceptedList accepted_; // 本次读事件accept到的连接，复用容量
+    std::shared_ptr<Stats> stats_;
 };
\ No newline at end of file
@@ -1,8 +1,13 @@
 #pragma once
-#include <vector>
 #include <string>
+#include <memory>
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <stddef.h>
+#include <endian.h>
+#include <sys/types.h>
+#include "BufferPool.hpp"
 
 // 底层缓冲区类型
 class Buffer
@@ -12,13 +17,34 @@ public:
     static const size_t CHEAP_PREPEND = 8; 
     static const size_t INIT_SIZE = 1024;
 
-    explicit Buffer(size_t initialSize = INIT_SIZE)
-        : buffer_(CHEAP_PREPEND + INIT_SIZE), readerIndex_(CHEAP_PREPEND), writerIndex_(CHEAP_PREPEND){}
-    
+    // 底层内存在第一次写入时才分配，initialSize为第一次分配的大小
+    // 指定pool时从内存池中分配，并且在数据全部被读取后立即把内存归还给内存池，空闲的Buffer不占用内存
+    explicit Buffer(size_t initialSize = INIT_SIZE, std::shared_ptr<BufferPool> pool = nullptr)
+        : pool_(std::move(pool)), buffer_(nullptr), capacity_(0), pooled_(false),
+          readerIndex_(CHEAP_PREPEND), writerIndex_(CHEAP_PREPEND), initialSize_(initialSize) {}
+    ~Buffer() { releaseStorage(); }
+
+    Buffer(const Buffer &rhs);
+    Buffer(Buffer &&rhs) noexcept : Buffer(rhs.initialSize_) { swap(rhs); }
+    Buffer &operator=(Buffer rhs) { swap(rhs); return *this; }
+
+    void swap(Buffer &rhs) noexcept
+    {
+        pool_.swap(rhs.pool_);
+        std::swap(buffer_, rhs.buffer_);
+        std::swap(capacity_, rhs.capacity_);
+        std::swap(pooled_, rhs.pooled_);
+        std::swap(readerIndex_, rhs.readerIndex_);
+        std::swap(writerIndex_, rhs.writerIndex_);
+        std::swap(initialSize_, rhs.initialSize_);
+    }
+
     // 查看可读字节数
     size_t readableBytes() const { return writerIndex_ - readerIndex_;}
     // 查看剩余可写空间
-    size_t writableBytes() const { return buffer_.size() - writerIndex_;}
+    size_t writableBytes() const { return capacity_ > writerIndex_ ? capacity_ - writerIndex_ : 0;}
+    // 底层内存的大小，未分配时为0
+    size_t capacity() const { return capacity_; }
     // 返回可覆盖空间的后一个位置
     size_t prependableBytes() const { return readerIndex_;}
 
@@ -38,7 +64,11 @@ public:
             retrieveAll();
         }
     }
-    void retrieveAll() { readerIndex_ = writerIndex_ = CHEAP_PREPEND; }
+    void retrieveAll()
+    {
+        readerIndex_ = writerIndex_ = CHEAP_PREPEND;
+        if (pool_) releaseStorage(); // 数据已全部读取，内存归还给内存池
+    }
 
     // 将onMessage函数上报的Buffer数据转化成string
     std::string retrieveAllAsString() { return retrieveAsString(readableBytes()); }
@@ -68,34 +98,64 @@ public:
     const char* beginWrite() const { return begin() + writerIndex_; }
     char* beginWrite() { return begin() + writerIndex_; }
 
-    // 从fd上读取数据
+    // 以网络字节序（大端）追加整数
+    void appendInt64(int64_t x) { uint64_t be = htobe64(static_cast<uint64_t>(x)); append(reinterpret_cast<const char*>(&be), sizeof(be)); }
+    void appendInt32(int32_t x) { uint32_t be = htobe32(static_cast<uint32_t>(x)); append(reinterpret_cast<const char*>(&be), sizeof(be)); }
+    void appendInt16(int16_t x) { uint16_t be = htobe16(static_cast<uint16_t>(x)); append(reinterpret_cast<const char*>(&be), sizeof(be)); }
+    void appendInt8(int8_t x) { append(reinterpret_cast<const char*>(&x), sizeof(x)); }
+
+    // 查看可读数据开头的大端整数，要求readableBytes()不小于整数的长度
+    int64_t peekInt64() const { uint64_t be; ::memcpy(&be, peek(), sizeof(be)); return static_cast<int64_t>(be64toh(be)); }
+    int32_t peekInt32() const { uint32_t be; ::memcpy(&be, peek(), sizeof(be)); return static_cast<int32_t>(be32toh(be)); }
+    int16_t peekInt16() const { uint16_t be; ::memcpy(&be, peek(), sizeof(be)); return static_cast<int16_t>(be16toh(be)); }
+    int8_t peekInt8() const { return static_cast<int8_t>(*peek()); }
+
+    // 读取并移除可读数据开头的大端整数
+    int64_t readInt64() { int64_t x = peekInt64(); retrieve(sizeof(x)); return x; }
+    int32_t readInt32() { int32_t x = peekInt32(); retrieve(sizeof(x)); return x; }
+    int16_t readInt16() { int16_t x = peekInt16(); retrieve(sizeof(x)); return x; }
+    int8_t readInt8() { int8_t x = peekInt8(); retrieve(sizeof(x)); return x; }
+
+    // 把数据写到可读数据之前的预留空间中，不移动已有数据，要求prependableBytes() >= len
+    // 写入数据后再在CHEAP_PREPEND中写入长度等消息头，发送时不需要为消息头重新拷贝一次数据
+    void prepend(const void *data, size_t len)
+    {
+        if (buffer_ == nullptr) reallocate(CHEAP_PREPEND + initialSize_); // 不能写入共享的emptyStorage_
+        readerIndex_ -= len;
+        ::memcpy(begin() + readerIndex_, data, len);
+    }
+    void prependInt64(int64_t x) { uint64_t be = htobe64(static_cast<uint64_t>(x)); prepend(&be, sizeof(be)); }
+    void prependInt32(int32_t x) { uint32_t be = htobe32(static_cast<uint32_t>(x)); prepend(&be, sizeof(be)); }
+    void prependInt16(int16_t x) { uint16_t be = htobe16(static_cast<uint16_t>(x)); prepend(&be, sizeof(be)); }
+    void prependInt8(int8_t x) { prepend(&x, sizeof(x)); }
+
+    // 从fd上读取数据，超出可写空间的数据先读入线程局部的64KB溢出区
     ssize_t readFd(int fd, int *saveErrno);
+    // 从fd上读取数据，读取前保证至少有hint字节可写空间，超出的数据先读入extrabuf
+    // capacity不为空时返回本次readv的总容量，返回值小于它说明fd中的数据已经读完
+    ssize_t readFd(int fd, int *saveErrno, size_t hint, char *extrabuf, size_t extrasize,
+                   size_t *capacity = nullptr);
     // 将数据写入fd
     ssize_t writeFd(int fd, int *saveErrno);
 
 private:
-    char *begin() {return &buffer_[0];} // 返回Buffer的首地址
-    const char* begin() const { return &buffer_[0];}
+    // 未分配内存时返回一块静态的空区域，保证peek()等接口始终返回有效地址
+    char *begin() { return buffer_ != nullptr ? buffer_ : emptyStorage_; } // 返回Buffer的首地址
+    const char* begin() const { return buffer_ != nullptr ? buffer_ : emptyStorage_; }
     // 扩容函数
-    void makeSpace(size_t len)
-    {
-        // 可覆盖空间 + 剩余可写空间 < 所需空间
-        if (writableBytes() + prependableBytes() < len + CHEAP_PREPEND)
-        {
-            buffer_.resize(writerIndex_ + len);
-        }
-        else // 可覆盖空间 + 剩余可写空间 >= 所需空间
-        {
-            // 把可读数据移动到起始位置，空出来的空间即可写入数据
-            // 这么做的原因是，如果重新分配内存，反正也是要把数据拷到新分配的内存区域，代价只会更大
-            size_t readable = readableBytes();
-            std::copy(begin() + readerIndex_, begin() + writerIndex_, begin() + CHEAP_PREPEND);
-            readerIndex_ = CHEAP_PREPEND;
-            writerIndex_ = readerIndex_ + readable;
-        }
-    }
+    void makeSpace(size_t len);
+    // 分配至少size字节的内存并把可读数据拷贝过去
+    void reallocate(size_t size);
+    void releaseStorage();
+
 private:
-    std::vector<char> buffer_;
+    std::shared_ptr<BufferPool> pool_;  // 为空时直接使用malloc
+    char *buffer_;
+    size_t capacity_;
+    bool pooled_;           // buffer_是否来自pool_
     size_t readerIndex_;    // 指向可读数据的第一个下标索引号
     size_t writerIndex_;    // 指向可写空间的第一个下标索引号
+    size_t initialSize_;
+
+    static char emptyStorage_[CHEAP_PREPEND];
 };
\ No newline at end of file
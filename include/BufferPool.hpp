@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <sys/types.h>
+#include "noncopyable.hpp"
+
+/*
+* Buffer的内存池，每个EventLoop拥有一个
+* 内存按2KB到256KB的2的幂划分为多个规格，每个规格从2MB的slab中切分出固定大小的块，
+* 释放的块进入对应规格的空闲链表，再次分配时直接复用，loop线程中的分配和释放都不需要加锁
+* 超过最大规格以及其他线程中的请求返回nullptr，由Buffer直接使用malloc
+*
+* 在其他线程中释放的块先放入无锁的远端释放栈，由loop线程在分配或trim时统一回收
+* trim()将超出保留量的空闲块通过madvise归还给操作系统，由EventLoop定期调用
+*/
+class BufferPool : noncopyable
+{
+public:
+    static const size_t kMinChunkSize = 2 * 1024;
+    static const size_t kMaxChunkSize = 256 * 1024;
+    static const int kNumClasses = 8;                       // 2K, 4K, ..., 256K
+    static const size_t kSlabSize = 2 * 1024 * 1024;        // 与大页大小相同
+    static const size_t kRetainBytesPerClass = 256 * 1024;  // trim后每个规格保留的空闲内存
+
+    BufferPool();
+    ~BufferPool();
+
+    // 分配至少size字节的内存，实际大小通过*actual返回，无法由内存池分配时返回nullptr
+    char *allocate(size_t size, size_t *actual);
+    // 归还allocate返回的内存，capacity为allocate返回的实际大小，可以在任意线程中调用
+    void deallocate(char *ptr, size_t capacity);
+    // 回收远端释放的块，并把多余的空闲块归还给操作系统，只能在所属线程中调用
+    void trim();
+
+    // 统计信息
+    size_t slabBytes() const { return slabBytes_; }                     // 已映射的slab总大小
+    size_t freeBytes() const { return freeBytes_; }                     // 空闲链表中的内存
+
+    // 设置之后创建的内存池是否使用大页，也可以通过环境变量TCPSERVER_HUGEPAGES=1开启
+    static void setUseHugePages(bool on) { useHugePages_ = on; }
+
+private:
+    // 远端释放的块，复用块本身的内存作为链表节点
+    struct RemoteNode
+    {
+        RemoteNode *next;
+        size_t capacity;
+    };
+
+    struct SizeClass
+    {
+        size_t chunkSize;
+        std::vector<char*> hot;     // 最近释放的块，物理内存仍然有效
+        std::vector<char*> cold;    // 已经madvise归还给操作系统的块，再次使用时由缺页重新分配
+        char *carveCur;             // 当前slab中尚未切分的区域
+        char *carveEnd;
+    };
+
+    static int classIndex(size_t size);
+    bool inOwnerThread() const;
+    char *newSlab();
+    void drainRemoteFrees();
+    void deallocateLocal(char *ptr, int index);
+
+private:
+    const pid_t ownerTid_;
+    const bool hugePages_;
+    SizeClass classes_[kNumClasses];
+    std::vector<std::pair<char*, bool>> slabs_;     // slab地址以及是否为MAP_HUGETLB映射
+    size_t slabBytes_;
+    size_t freeBytes_;
+    std::atomic<RemoteNode*> remoteFrees_;
+
+    static bool useHugePages_;
+};
@@ -11,4 +11,5 @@ using ConnectionCallback = std::function<void(const TcpConnectionPtr &)>;
 using CloseCallback = std::function<void(const TcpConnectionPtr &)>;
 using WriteCompleteCallback = std::function<void(const TcpConnectionPtr &)>;
 using HighWaterMarkCallback = std::function<void(const TcpConnectionPtr &, size_t)>;
-using MessageCallback = std::function<void(const TcpConnectionPtr &, Buffer*, Timestamp)>;
\ No newline at end of file
+using MessageCallback = std::function<void(const TcpConnectionPtr &, Buffer*, Timestamp)>;
+using TimerCallback = std::function<void()>;
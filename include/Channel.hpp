@@ -4,6 +4,7 @@
 #include <memory>
 #include "noncopyable.hpp"
 #include "Timestamp.hpp"
+#include "InplaceFunction.hpp"
 
 class EventLoop;
 
@@ -13,8 +14,8 @@ class EventLoop;
 class Channel : noncopyable
 {
 public:
-    using EventCallback = std::function<void()>; // 通用事件的回调函数
-    using ReadEventCallback = std::function<void(Timestamp)>; // 读事件回调函数
+    using EventCallback = InplaceFunction<void()>; // 通用事件的回调函数
+    using ReadEventCallback = InplaceFunction<void(Timestamp)>; // 读事件回调函数
 
     Channel(EventLoop *loop, int fd);
     ~Channel(){};
@@ -34,6 +35,15 @@ public:
     // 返回对应类成员变量的值
     int fd() const {return fd_;}
     int events() const {return events_;}
+    // 实际注册到Poller中的事件，边沿触发模式下与events_不同
+    int pollEvents() const
+    {
+        if (events_ == noneEvent) return events_;
+        int events = edgeTriggered_ ? (readEvent | writeEvent | edgeEvent) : events_;
+        // EPOLLEXCLUSIVE不允许与EPOLLPRI同时使用
+        if (exclusive_) events = (events & ~urgentEvent) | exclusiveEvent;
+        return events;
+    }
 
     bool isNoneEvent() const { return events_ == noneEvent;}
     bool isWriting() const { return events_ & writeEvent;}
@@ -50,27 +60,48 @@ public:
     // 设置实际触发的事件
     void set_revents(int revents) {revents_ = revents;}
 
+    // 边沿触发模式：注册后一直以EPOLLIN|EPOLLOUT|EPOLLET监听，读写事件的开关只修改events_，
+    // 不再调用epoll_ctl，由上层根据events_自行决定是否处理就绪事件
+    // 需要在第一次enableReading之前设置
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+    bool edgeTriggered() const { return edgeTriggered_; }
+
+    // 多个loop监听同一个fd时以EPOLLEXCLUSIVE注册，每次就绪只唤醒其中一个loop
+    // 注册之后不能再修改监听的事件，只能整体移除，需要在第一次enableReading之前设置
+    void setExclusive(bool on) { exclusive_ = on; }
+
     // 设置fd监听的事件
-    void enableReading() { events_ |= readEvent; update();}
-    void disableReading() { events_ &= ~readEvent; update();}
-    void enableWriting() { events_ |= writeEvent; update();}
-    void disableWriting() { events_ &= ~writeEvent; update();}
-    void disbaleAll() { events_ &= noneEvent; update();}
+    void enableReading() { events_ |= readEvent; updateIfChanged();}
+    void disableReading() { events_ &= ~readEvent; updateIfChanged();}
+    void enableWriting() { events_ |= writeEvent; updateIfChanged();}
+    void disableWriting() { events_ &= ~writeEvent; updateIfChanged();}
+    void disbaleAll() { events_ &= noneEvent; updateIfChanged();}
 
 private:
     void update(); // 更新fd在epollfd上的状态
+    // 水平触发模式下每次修改都更新，边沿触发模式下只在注册的事件发生变化时更新
+    void updateIfChanged()
+    {
+        if (!edgeTriggered_ || pollEvents() != registeredEvents_) update();
+    }
     void handleEventWithGuard(Timestamp receiveTime);
 
 private:
     static const int noneEvent;
     static const int readEvent;
     static const int writeEvent;
+    static const int edgeEvent;
+    static const int urgentEvent;
+    static const int exclusiveEvent;
 
     EventLoop *loop_;   // 事件循环
     const int fd_;      // Poller的监听对象
     int events_;        // fd想要监听的事件
     int revents_;       // Poller返回的实际发生的事件
     int index_;         // 指示Channel的状态：未插入Poller；已插入Poller；已插入Poller但不在epoll上
+    bool edgeTriggered_;    // 是否使用边沿触发模式
+    bool exclusive_;        // 是否以EPOLLEXCLUSIVE注册
+    int registeredEvents_;  // 最近一次注册到Poller中的事件
 
     std::weak_ptr<void> tie_;
     bool tied_;
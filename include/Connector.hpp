@@ -0,0 +1,81 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <random>
+#include "noncopyable.hpp"
+#include "InetAddress.hpp"
+#include "TimerId.hpp"
+#include "Timestamp.hpp"
+
+class Channel;
+class EventLoop;
+
+/*
+* 主动发起的非阻塞连接
+* connect返回EINPROGRESS后通过Channel等待可写事件，再用SO_ERROR判断是否连接成功
+* 连接失败时按指数退避重试，每次的延迟在[d/2, d]之间随机选取，避免大量客户端同时重连
+* 连接成功后把sockfd交给NewConnectionCallback，之后不再管理该fd
+* 由shared_ptr管理，重试定时器只持有weak_ptr
+*/
+class Connector : noncopyable, public std::enable_shared_from_this<Connector>
+{
+public:
+    using NewConnectionCallback = std::function<void(int sockfd)>;
+
+    static constexpr double kDefaultInitRetryDelay = 0.5;   // 秒
+    static constexpr double kDefaultMaxRetryDelay = 30.0;
+    // 连接保持超过该时间（秒）后断开，重连时退避延迟从初始值开始
+    static constexpr double kMinStableTime = 5.0;
+
+    Connector(EventLoop *loop, const InetAddress &serverAddr);
+    ~Connector();
+
+    void setNewConnectionCallback(const NewConnectionCallback &cb) { newConnectionCallback_ = cb; }
+    // 设置重试的初始延迟和最大延迟，单位为秒，需要在start之前调用
+    void setRetryDelay(double initial, double max);
+
+    const InetAddress &serverAddress() const { return serverAddr_; }
+
+    void start();   // 开始连接，线程安全
+    void restart(); // 连接断开后按退避延迟重新连接，只能在loop线程中调用
+    void stop();    // 停止连接和重试，线程安全
+
+private:
+    enum States
+    {
+        kDisconnected,
+        kConnecting,
+        kConnected,
+    };
+
+    void setState(States s) { state_ = s; }
+    void startInLoop();
+    void stopInLoop();
+    void connect();
+    void connecting(int sockfd);
+    void handleWrite();
+    void handleError();
+    void retry(int sockfd);
+    void scheduleRetry();   // 按退避延迟和随机抖动安排下一次连接
+    int removeAndResetChannel();
+    void resetChannel();
+    double nextRetryDelay(); // 本次重试的延迟，并把下一次的退避延迟翻倍
+
+private:
+    EventLoop *loop_;
+    const InetAddress serverAddr_;
+    std::atomic<bool> connect_;     // 上层是否希望连接
+    States state_;                  // 只在loop线程中访问
+    std::unique_ptr<Channel> channel_;  // 等待连接完成期间使用
+    NewConnectionCallback newConnectionCallback_;
+    double initRetryDelay_;
+    double maxRetryDelay_;
+    double retryDelay_;             // 当前的退避延迟
+    Duration connectedAt_;          // 最近一次连接建立时的单调时钟读数
+    TimerId retryTimer_;
+    bool retryPending_;
+    std::mt19937 random_;           // 重试延迟的随机抖动
+};
+
+using ConnectorPtr = std::shared_ptr<Connector>;
@@ -3,19 +3,84 @@
 #include <vector>
 #include <atomic>
 #include <memory>
-#include <mutex>
 #include "noncopyable.hpp"
 #include "Timestamp.hpp"
 #include "CurrentThread.hpp"
+#include "Callbacks.hpp"
+#include "TimerId.hpp"
+#include "MpscQueue.hpp"
+#include "InplaceFunction.hpp"
+#include "TraceRing.hpp"
+#include "Metrics.hpp"
 
 class Channel;
 class Poller;
+class TimerQueue;
+class TimingWheel;
+class BufferPool;
 
 // 事件循环类
 class EventLoop : noncopyable
 {
 public:
-    using Functor = std::function<void()>;
+    // 入队的回调不分配堆内存，捕获超过容量时编译失败
+    using Functor = InplaceFunction<void()>;
+
+    // 读路径统计，只由loop线程写入，其他线程可以随时读取
+    struct ReadStats
+    {
+        static const int kBuckets = 20;             // 第i个桶统计[2^i, 2^(i+1))字节的读取，最后一个桶包含更大的读取
+        std::atomic<uint64_t> reads{0};             // 读到数据的readv次数
+        std::atomic<uint64_t> bytes{0};             // 读到的总字节数
+        std::atomic<uint64_t> events{0};            // 处理的读事件数
+        std::atomic<uint64_t> budgetExhausted{0};   // 因达到单次事件读取上限而停止的次数
+        std::atomic<uint64_t> sizeHistogram[kBuckets] = {};
+
+        void record(size_t n)
+        {
+            int bucket = 0;
+            while (bucket < kBuckets - 1 && (n >> (bucket + 1)) != 0) ++bucket;
+            increment(reads);
+            bytes.store(bytes.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+            increment(sizeHistogram[bucket]);
+        }
+        // 单写者计数，不需要原子的读-改-写
+        static void increment(std::atomic<uint64_t> &counter)
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    };
+
+    // 负载统计，供EventLoopThreadPool选择subloop时读取，任意线程都可以读取
+    struct LoadStats
+    {
+        std::atomic<uint32_t> connections{0};       // 本loop中已建立且尚未销毁的连接数
+        std::atomic<uint32_t> pendingConnections{0};// 已分配给本loop但尚未建立的连接数，由TcpServer在选择loop时计入
+        std::atomic<uint32_t> pendingFunctors{0};   // 其他线程投递且尚未执行的回调数
+        std::atomic<uint64_t> iterationUs{0};       // 每轮循环处理事件和回调的耗时（微秒，指数滑动平均），不含阻塞等待
+    };
+
+    // 循环和写路径统计，只由loop线程写入，其他线程可以随时读取
+    struct LoopStats
+    {
+        std::atomic<uint64_t> iterations{0};        // 循环轮数
+        std::atomic<uint64_t> events{0};            // poll返回的活跃Channel总数
+        std::atomic<uint64_t> functors{0};          // 执行的回调数
+        std::atomic<uint64_t> writes{0};            // 写到数据的write/writev次数
+        std::atomic<uint64_t> bytesWritten{0};      // 写出的总字节数
+        std::atomic<uint64_t> highWaterMarkHits{0}; // 连接输出队列超过高水位的次数
+        std::atomic<uint64_t> readPauses{0};        // 因背压暂停源连接读取的次数
+        std::atomic<uint64_t> outputBacklog{0};     // 本loop所有连接输出队列中待发送的字节数
+        LatencyHistogram iterationTime;             // 从poll返回到回调执行完
+        LatencyHistogram handlerTime;               // 处理活跃Channel的耗时
+        LatencyHistogram queueLatency;              // 其他线程queueInLoop到回调开始执行
+    };
+
+    // 每轮循环最多执行的回调数，避免大量回调饿死IO事件
+    static const int kPendingFunctorsBudget = 1024;
+
+    // 所有连接共享的读溢出区大小
+    static constexpr size_t kReadOverflowSize = 64 * 1024;
 
     EventLoop();
     ~EventLoop();
@@ -30,22 +95,56 @@ public:
     // 在当前loop中执行
     void runInLoop(Functor cb);
     // 把上层注册的回调函数放入队列中，唤醒loop所在的线程执行回调函数
+    // 无锁且线程安全，同一轮循环中只有第一个需要唤醒loop的调用者写eventfd
     void queueInLoop(Functor cb);
 
     // 通过eventfd唤醒loop所在的线程
     void wakeup();
 
+    // 定时器接口，线程安全，回调总是在loop所在的线程中执行
+    // 在time时刻执行cb
+    TimerId runAt(Timestamp time, TimerCallback cb);
+    // 在delay秒后执行cb
+    TimerId runAfter(double delay, TimerCallback cb);
+    // 每隔interval秒执行一次cb
+    TimerId runEvery(double interval, TimerCallback cb);
+    // 取消定时器
+    void cancel(TimerId timerId);
+
+    // 读取时超出Buffer可写空间的数据暂存的位置，由loop中所有连接共享
+    char *readOverflow() { return readOverflow_.get(); }
+    ReadStats &readStats() { return readStats_; }
+    LoadStats &loadStats() { return loadStats_; }
+    LoopStats &loopStats() { return loopStats_; }
+    // 本loop的事件跟踪环，Channel的事件处理和Poller的注册操作写入其中
+    TraceRing &traceRing() { return traceRing_; }
+
+    // 本loop中连接的Buffer所使用的内存池
+    const std::shared_ptr<BufferPool> &bufferPool() const { return bufferPool_; }
+
+    // 用于连接空闲超时的时间轮，第一次使用时创建，只能在loop所在的线程中调用
+    TimingWheel *timingWheel();
+
     void updateChannel(Channel* channel);
     void removeChannel(Channel* channel);
     bool hasChannel(Channel* channel);
+    // 当前的IO复用实现是否支持边沿触发
+    bool supportsEdgeTriggered() const;
+
+    // loop线程绑定的cpu和内存所在的NUMA节点，未绑定时为-1，由EventLoopThread在创建loop后设置
+    int cpu() const { return cpu_; }
+    int numaNode() const { return numaNode_; }
+    void setPlacement(int cpu, int numaNode) { cpu_ = cpu; numaNode_ = numaNode; }
 
     // 判断EventLoop对象是否在调用者的线程中
     bool isInLoopThread() const { return threadId_ == CurrentThread::tid();}
 private:
     // 给eventfd返回的文件描述符wakeupFd_绑定的事件回调,当wakeup()时,即有事件发生时,调用handleRead()读wakeupFd_的8字节,同时唤醒阻塞的epoll_wait
     void handleRead();
-    // 执行上层回调
+    // 执行上层回调，每轮最多执行kPendingFunctorsBudget个
     void doPendingFunctions();
+    // 更新loadStats_和loopStats_中的每轮耗时，handlersDone为处理完活跃Channel时的单调时钟读数
+    void recordIteration(Duration handlersDone);
 
 private:
     using ChannelList = std::vector<Channel*>;
@@ -54,9 +153,20 @@ private:
     std::atomic_bool quit_;     // 循环退出标志
 
     const pid_t threadId_;      // 当前EventLoop所属线程id
+    int cpu_;                   // 绑定的cpu
+    int numaNode_;              // 内存分配所在的NUMA节点
 
     Timestamp pollReturnTime_;  // Poller返回发生事件的Channels的时间点
+    Duration pollReturnMono_;   // 同一时刻的单调时钟读数，用于统计本轮耗时
+    TraceRing traceRing_;       // 需要先于poller_和timerQueue_构造，它们在构造时就会注册Channel
     std::unique_ptr<Poller> poller_;    // 一个EventLoop对应一个Poller
+    std::unique_ptr<TimerQueue> timerQueue_; // 基于timerfd的定时器队列
+    std::unique_ptr<TimingWheel> timingWheel_; // 空闲超时时间轮，依赖timerQueue_
+    std::shared_ptr<BufferPool> bufferPool_;   // Buffer内存池，连接可能晚于loop析构，因此共享所有权
+    std::unique_ptr<char[]> readOverflow_;      // 读溢出区，只分配一次且从不清零
+    ReadStats readStats_;
+    LoadStats loadStats_;
+    LoopStats loopStats_;
 
     int wakeupFd_;              // 用于唤醒阻塞在epoll_wait中的Loop线程，因为线程会监听wakeupChannel,在wakeupFd_中写入相当于人为制造了一个写入事件
     std::unique_ptr<Channel> wakeupChannel_;
@@ -64,6 +174,16 @@ private:
     ChannelList activecChannels_;// Poller检测到的当前有事件发生的所有Channel列表
 
     std::atomic_bool callingPendingFuntors_;    // 表示当前loop是否有需要执行的回调操作
-    std::vector<Functor> pengdingFuntors_;      // 存储loop需要执行的所有回调操作
-    std::mutex mutex_;                          // 保护vector的线程安全操作
+    // 其他线程入队的回调，记录入队时间用于统计排队延迟
+    struct QueuedFunctor
+    {
+        Functor functor;
+        Duration enqueueTime;   // 单调时钟读数
+    };
+    MpscQueue<QueuedFunctor> pengdingFuntors_;  // 存储loop需要执行的所有回调操作，其他线程无锁入队
+    // loop在阻塞前一定会检查pengdingFuntors_，或已有生产者写过eventfd，此时新的生产者不需要再唤醒loop
+    // 由loop在执行回调前清除
+    std::atomic_bool wakeupPending_;
+    std::vector<Functor> localFunctors_;        // loop线程自己入队的回调，不需要原子操作和节点分配
+    std::vector<Functor> runningFunctors_;      // 本轮取出的回调，复用容量
 };
\ No newline at end of file
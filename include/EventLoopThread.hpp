@@ -3,6 +3,7 @@
 #include <mutex>
 #include <condition_variable>
 #include <string>
+#include <vector>
 #include "noncopyable.hpp"
 #include "Thread.hpp"
 
@@ -18,11 +19,17 @@ public:
                     const std::string &name = std::string());
     ~EventLoopThread();
 
+    // 设置loop线程的cpu亲和性，numaLocal为true时内存优先从线程所在cpu的NUMA节点分配
+    // 需要在startLoop之前调用，在线程中创建EventLoop之前生效，loop的内存池和读溢出区因此分配在本地节点
+    void setPlacement(const std::vector<int> &cpus, bool numaLocal);
+
     EventLoop *startLoop();
 
 private:
     // EventLoop对应线程的线程函数
     void threadFunc();
+    // 在loop线程中应用cpus_和numaLocal_，返回绑定后所在的cpu和NUMA节点
+    void applyPlacement(int *cpu, int *node);
 
 private:
     EventLoop* loop_;
@@ -31,4 +38,6 @@ private:
     std::mutex mutex_;
     std::condition_variable cond_;
     ThreadInitCallback callback_;
+    std::vector<int> cpus_;     // 允许运行的cpu，为空时不设置亲和性
+    bool numaLocal_;
 };
\ No newline at end of file
@@ -7,20 +7,44 @@
 
 class EventLoop;
 class EventLoopThread;
+class InetAddress;
 
 class EventLoopThreadPool : noncopyable
 {
 public:
     using ThreadInitCallback = std::function<void(EventLoop*)>;
+    // 自定义的subloop选择函数，peerAddr可能为空
+    using LoopSelector = std::function<EventLoop*(const std::vector<EventLoop*> &loops, const InetAddress *peerAddr)>;
+
+    // 为新连接选择subloop的策略，负载数据来自各loop的EventLoop::LoadStats
+    enum SelectPolicy
+    {
+        kRoundRobin,        // 轮询
+        kLeastConnections,  // 连接数最少
+        kLeastPending,      // 待执行的跨线程回调最少
+        kLowestLatency,     // 最近每轮循环耗时最短
+        kPowerOfTwoChoices, // 随机选两个loop，取连接数较少的一个
+        kPeerHash,          // 按对端ip哈希，同一客户端总是分配到同一个loop
+    };
 
     EventLoopThreadPool(EventLoop *baseLoop, const std::string &nameArg);
     ~EventLoopThreadPool();
 
     void setThreadNum(int numThreads) { numThreads_ = numThreads; }
+    // 第i个subloop线程绑定到cpuSets[i % cpuSets.size()]中的cpu，需要在start之前调用
+    void setCpuAffinity(const std::vector<std::vector<int>> &cpuSets) { cpuSets_ = cpuSets; }
+    // subloop的内存优先从所在cpu的NUMA节点分配，需要在start之前调用
+    void setNumaLocal(bool on) { numaLocal_ = on; }
 
     void start(const ThreadInitCallback &cb = ThreadInitCallback());
 
-    EventLoop* getNextLoop(); // 轮询为将新Channel分配给subLoop
+    // 设置选择策略，getNextLoop只在baseLoop线程中调用，因此可以在运行中修改
+    void setSelectPolicy(SelectPolicy policy) { policy_ = policy; }
+    // 设置自定义的选择函数，设置后代替SelectPolicy
+    void setLoopSelector(const LoopSelector &selector) { selector_ = selector; }
+
+    EventLoop* getNextLoop(); // 按选择策略为新Channel分配subLoop，kPeerHash策略下退化为轮询
+    EventLoop* getNextLoop(const InetAddress &peerAddr);
 
     std::vector<EventLoop*> getAllLoops();
 
@@ -28,11 +52,23 @@ public:
     const std::string name() const { return name_; }
 
 private:
+    EventLoop *selectLoop(const InetAddress *peerAddr);
+    EventLoop *roundRobin();
+    // 返回负载最小的loop，负载相同时从轮询位置开始取第一个，避免总是选中靠前的loop
+    template <typename Load>
+    EventLoop *leastLoaded(Load load);
+    uint32_t nextRandom();
+
     EventLoop *baseLoop_;
     std::string name_;
     bool started_;
     int numThreads_;        //线程池中线程的数量
     int next_;              //指向下一个将被分配Channel的线程
+    SelectPolicy policy_;   //subloop选择策略
+    LoopSelector selector_; //自定义选择函数
+    uint32_t seed_;         //kPowerOfTwoChoices使用的随机数状态
+    std::vector<std::vector<int>> cpuSets_; //subloop线程的cpu亲和性
+    bool numaLocal_;        //subloop是否使用本地NUMA节点的内存
     std::vector<std::unique_ptr<EventLoopThread>> threads_; // EventLoop线程列表
     std::vector<EventLoop*> loops_;                         // EventLoop列表，与EventLoop线程对应
 };
\ No newline at end of file
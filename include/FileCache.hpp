@@ -0,0 +1,82 @@
+#pragma once
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/stat.h>
+#include "noncopyable.hpp"
+#include "Timestamp.hpp"
+
+/*
+* 打开的普通文件及其stat信息，析构时关闭fd
+* 通过shared_ptr在缓存和正在发送该文件的连接之间共享，被缓存淘汰后仍然保持打开直到发送完成
+*/
+class CachedFile : noncopyable
+{
+public:
+    CachedFile(int fd, const struct stat &st) : fd_(fd), stat_(st) {}
+    ~CachedFile();
+
+    int fd() const { return fd_; }
+    off_t size() const { return stat_.st_size; }
+    time_t mtime() const { return stat_.st_mtime; }
+    const struct stat &stat() const { return stat_; }
+
+private:
+    const int fd_;
+    const struct stat stat_;
+};
+
+using CachedFilePtr = std::shared_ptr<const CachedFile>;
+
+/*
+* 文件描述符和stat信息的缓存，避免每个静态文件请求都执行open、fstat和close
+* 最多保持maxOpenFiles个文件打开，超出时按LRU淘汰
+* 缓存项超过revalidateInterval没有验证时重新stat路径，inode、大小或修改时间变化则重新打开
+* 线程安全，可以由多个loop线程共享，系统调用在锁外执行
+*/
+class FileCache : noncopyable
+{
+public:
+    static constexpr size_t kDefaultMaxOpenFiles = 1024;
+    static constexpr double kDefaultRevalidateInterval = 1.0;
+
+    explicit FileCache(size_t maxOpenFiles = kDefaultMaxOpenFiles,
+                       double revalidateInterval = kDefaultRevalidateInterval);
+
+    // 返回path对应的打开的普通文件，失败时返回nullptr并通过savedErrno返回原因
+    // 不是普通文件时返回EISDIR（目录）或EACCES
+    CachedFilePtr open(const std::string &path, int *savedErrno);
+    // 移除path的缓存项，已经返回的文件不受影响
+    void invalidate(const std::string &path);
+    void clear();
+
+    size_t size() const;
+    uint64_t hits() const;
+    uint64_t misses() const;
+
+private:
+    struct Entry
+    {
+        CachedFilePtr file;
+        Duration validatedAt;                       // 上次确认与磁盘一致的单调时钟读数
+        std::list<std::string>::iterator lruPos;
+    };
+
+    // 打开path并fstat，不访问缓存
+    static CachedFilePtr openFile(const std::string &path, int *savedErrno);
+    static bool sameFile(const struct stat &a, const struct stat &b);
+    // 加入或替换path的缓存项，被淘汰的文件通过evicted返回，在锁外析构
+    void insert(const std::string &path, const CachedFilePtr &file, Duration now, std::vector<CachedFilePtr> *evicted);
+
+    const size_t maxOpenFiles_;
+    const Duration revalidateInterval_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Entry> entries_;
+    std::list<std::string> lru_;                    // 队首为最近使用的路径
+    uint64_t hits_;
+    uint64_t misses_;
+};
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include "HttpRequest.hpp"
+#include "Timestamp.hpp"
+
+class Buffer;
+
+/*
+* 每个连接一个的HTTP请求解析器，作为TcpConnection的context保存
+* 在输入Buffer上原地解析，请求不完整时只记录已经扫描过的长度，下一次只扫描新到达的数据
+* 请求头和请求体完整之后才生成指向Buffer的视图，Buffer在两次读取之间扩容也不会留下失效的视图
+* 不支持分块传输编码的请求体，收到Transfer-Encoding时返回501
+*/
+class HttpContext
+{
+public:
+    enum ParseResult
+    {
+        kIncomplete,    // 需要更多数据
+        kComplete,      // request()中是一个完整的请求，长度为consumed()
+        kError,         // 请求无效，应返回errorStatus()并关闭连接
+    };
+
+    static const size_t kMaxHeaderSize = 64 * 1024;
+    static const size_t kMaxBodySize = 8 * 1024 * 1024;
+
+    HttpContext() : scanned_(0), headerLength_(0), bodyLength_(0), errorStatus_(0) {}
+
+    // 解析从buf->peek()开始的一个请求
+    ParseResult parse(const Buffer *buf, Timestamp receiveTime);
+
+    const HttpRequest &request() const { return request_; }
+    // 当前请求的总长度，请求处理完后从Buffer中移除这么多字节
+    size_t consumed() const { return headerLength_ + bodyLength_; }
+    int errorStatus() const { return errorStatus_; }
+
+    // 当前请求处理完并从Buffer中移除后调用，开始解析下一个请求
+    void reset()
+    {
+        scanned_ = 0;
+        headerLength_ = 0;
+        bodyLength_ = 0;
+        errorStatus_ = 0;
+        request_.reset();
+    }
+
+private:
+    // 解析[begin, end)中的请求行和请求头，end指向结尾的空行
+    bool parseHead(const char *begin, const char *end);
+    bool parseRequestLine(const char *begin, const char *end);
+    ParseResult fail(int status);
+
+    size_t scanned_;        // 已经扫描过且不含请求头结尾的字节数
+    size_t headerLength_;   // 请求头的长度，包括结尾的空行，为0表示请求头还不完整
+    size_t bodyLength_;
+    int errorStatus_;
+    HttpRequest request_;
+};
@@ -0,0 +1,85 @@
+#pragma once
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "Timestamp.hpp"
+
+/*
+* 解析后的HTTP请求，所有字段都是指向连接输入Buffer的string_view，不拷贝
+* 只在HttpServer的请求回调期间有效，需要保留的字段由回调自行拷贝
+*/
+class HttpRequest
+{
+public:
+    enum Method
+    {
+        kInvalid, kGet, kPost, kHead, kPut, kDelete, kOptions, kPatch,
+    };
+    enum Version
+    {
+        kUnknown, kHttp10, kHttp11,
+    };
+    using Header = std::pair<std::string_view, std::string_view>;
+
+    HttpRequest() : method_(kInvalid), version_(kUnknown) {}
+
+    Method method() const { return method_; }
+    std::string_view methodString() const { return methodString_; }
+    Version version() const { return version_; }
+    std::string_view path() const { return path_; }
+    std::string_view query() const { return query_; }   // 不含'?'
+    std::string_view body() const { return body_; }
+    Timestamp receiveTime() const { return receiveTime_; }
+    const std::vector<Header> &headers() const { return headers_; }
+
+    // 按名字查找请求头，名字不区分大小写，不存在时返回空
+    std::string_view getHeader(std::string_view name) const
+    {
+        for (const Header &header : headers_)
+        {
+            if (equalsIgnoreCase(header.first, name)) return header.second;
+        }
+        return std::string_view();
+    }
+
+    // HTTP/1.1默认保持连接，HTTP/1.0需要显式的Connection: keep-alive
+    bool keepAlive() const
+    {
+        std::string_view connection = getHeader("Connection");
+        if (version_ == kHttp11) return !equalsIgnoreCase(connection, "close");
+        return equalsIgnoreCase(connection, "keep-alive");
+    }
+
+    static bool equalsIgnoreCase(std::string_view a, std::string_view b)
+    {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); ++i)
+        {
+            // ASCII字母的大小写只差0x20，非字母字符按原值比较
+            char x = a[i], y = b[i];
+            if (x == y) continue;
+            if ((x | 0x20) != (y | 0x20) || (x | 0x20) < 'a' || (x | 0x20) > 'z') return false;
+        }
+        return true;
+    }
+
+private:
+    friend class HttpContext;
+
+    void reset()
+    {
+        method_ = kInvalid;
+        version_ = kUnknown;
+        methodString_ = path_ = query_ = body_ = std::string_view();
+        headers_.clear();   // 保留容量，同一连接上的请求复用
+    }
+
+    Method method_;
+    Version version_;
+    std::string_view methodString_;
+    std::string_view path_;
+    std::string_view query_;
+    std::string_view body_;
+    Timestamp receiveTime_;
+    std::vector<Header> headers_;
+};
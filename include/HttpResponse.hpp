@@ -0,0 +1,79 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/types.h>
+#include "Callbacks.hpp"
+
+/*
+* HTTP响应，由请求回调填写，HttpServer负责发送
+* 状态行和响应头拼接在一个string中，响应体可以是转移所有权的string或共享的只读数据
+* 发送时两者作为输出队列中的不同数据段，通过writev一起写出，响应体不拷贝
+* 响应体也可以是文件的一段，在响应头之后通过sendfile发送
+*/
+class HttpResponse
+{
+public:
+    explicit HttpResponse(bool close)
+        : statusCode_(200), closeConnection_(close), fileFd_(-1), fileOffset_(0), bodyLength_(0) {}
+
+    void setStatusCode(int code) { statusCode_ = code; }
+    int statusCode() const { return statusCode_; }
+    // 不设置时使用状态码对应的标准描述
+    void setStatusMessage(const std::string &message) { statusMessage_ = message; }
+
+    void setCloseConnection(bool on) { closeConnection_ = on; }
+    bool closeConnection() const { return closeConnection_; }
+
+    void setContentType(const std::string &contentType) { addHeader("Content-Type", contentType); }
+    // Content-Length和Connection由sendTo生成，不需要添加
+    void addHeader(const std::string &key, const std::string &value) { headers_.emplace_back(key, value); }
+
+    void setBody(std::string &&body) { clearBody(); body_ = std::move(body); bodyLength_ = body_.size(); }
+    void setBody(const std::string &body) { setBody(std::string(body)); }
+    // 共享的只读数据，如缓存的静态内容，多个响应发送同一份数据时不拷贝
+    void setBody(const std::shared_ptr<const std::string> &body)
+    {
+        clearBody();
+        sharedBody_ = body;
+        bodyLength_ = body ? body->size() : 0;
+    }
+    // 文件fd中[offset, offset + length)的部分，owner在发送完成之前保持fd打开
+    void setFileBody(int fd, off_t offset, size_t length, std::shared_ptr<const void> owner)
+    {
+        clearBody();
+        fileFd_ = fd;
+        fileOffset_ = offset;
+        fileOwner_ = std::move(owner);
+        bodyLength_ = length;
+    }
+    size_t bodyLength() const { return bodyLength_; }
+
+    // 把响应写入连接的输出队列，includeBody为false时只发送响应头（HEAD请求）
+    void sendTo(const TcpConnectionPtr &conn, bool includeBody = true);
+
+    // 状态码对应的标准描述
+    static const char *statusMessageOf(int code);
+
+private:
+    void clearBody()
+    {
+        body_.clear();
+        sharedBody_.reset();
+        fileFd_ = -1;
+        fileOwner_.reset();
+        bodyLength_ = 0;
+    }
+
+    int statusCode_;
+    std::string statusMessage_;
+    bool closeConnection_;
+    std::vector<std::pair<std::string, std::string>> headers_;
+    std::string body_;
+    std::shared_ptr<const std::string> sharedBody_;
+    int fileFd_;
+    off_t fileOffset_;
+    std::shared_ptr<const void> fileOwner_;
+    size_t bodyLength_;
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include <functional>
+#include <string>
+#include "noncopyable.hpp"
+#include "TcpServer.hpp"
+#include "HttpRequest.hpp"
+#include "HttpResponse.hpp"
+
+/*
+* 基于TcpServer的HTTP/1.1服务器
+* 支持keep-alive和pipelining：一次读事件中到达的所有完整请求依次交给回调处理，响应按请求顺序进入输出队列，
+* 处理期间连接处于cork状态，全部响应最后按顺序通过writev和sendfile连续写出
+* 请求回调在连接所属的loop线程中同步执行，需要异步处理的请求不应在回调中阻塞
+*/
+class HttpServer : noncopyable
+{
+public:
+    using HttpCallback = std::function<void(const HttpRequest &, HttpResponse *)>;
+
+    HttpServer(EventLoop *loop,
+               const InetAddress &listenAddr,
+               const std::string &name,
+               TcpServer::Option option = TcpServer::kNoReusePort);
+
+    // 未设置时对所有请求返回404
+    void setHttpCallback(const HttpCallback &cb) { httpCallback_ = cb; }
+    void setThreadNum(int numThreads) { server_.setThreadNum(numThreads); }
+    // 底层的TcpServer，用于设置accept方式、边沿触发、空闲超时等，需要在start之前设置
+    TcpServer &tcpServer() { return server_; }
+
+    void start();
+
+private:
+    void onConnection(const TcpConnectionPtr &conn);
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime);
+    // 请求无效时返回错误响应并关闭连接
+    void sendError(const TcpConnectionPtr &conn, int status);
+
+    TcpServer server_;
+    HttpCallback httpCallback_;
+};
@@ -0,0 +1,133 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/*
+* 只能移动的定长可调用对象，可调用对象直接存放在内部的Capacity字节中，构造、移动和调用都不会分配堆内存
+* 可调用对象超过Capacity或对齐要求过高时编译失败，此时应减少捕获的内容（如把多个参数打包进一个shared_ptr）
+* 用于loop内部频繁创建的回调：EventLoop::Functor和Channel的事件回调
+*/
+template <typename Signature, size_t Capacity = 64>
+class InplaceFunction;
+
+template <typename R, typename... Args, size_t Capacity>
+class InplaceFunction<R(Args...), Capacity>
+{
+public:
+    InplaceFunction() noexcept : ops_(nullptr) {}
+    InplaceFunction(std::nullptr_t) noexcept : ops_(nullptr) {}
+
+    template <typename F,
+              typename Fn = typename std::decay<F>::type,
+              typename = typename std::enable_if<!std::is_same<Fn, InplaceFunction>::value>::type>
+    InplaceFunction(F &&f) : ops_(nullptr)
+    {
+        static_assert(sizeof(Fn) <= Capacity,
+                      "callable does not fit in InplaceFunction, capture less or raise Capacity");
+        static_assert(alignof(Fn) <= alignof(Storage),
+                      "callable is over-aligned for InplaceFunction");
+        static_assert(std::is_nothrow_move_constructible<Fn>::value,
+                      "callable stored in InplaceFunction must be nothrow move constructible");
+        if (isNull(f)) return;
+        ::new (static_cast<void *>(&storage_)) Fn(std::forward<F>(f));
+        ops_ = &OpsFor<Fn>::ops;
+    }
+
+    InplaceFunction(InplaceFunction &&other) noexcept : ops_(other.ops_)
+    {
+        if (ops_ != nullptr)
+        {
+            ops_->move(&storage_, &other.storage_);
+            other.ops_ = nullptr;
+        }
+    }
+
+    InplaceFunction &operator=(InplaceFunction &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            if (other.ops_ != nullptr)
+            {
+                other.ops_->move(&storage_, &other.storage_);
+                ops_ = other.ops_;
+                other.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    InplaceFunction &operator=(std::nullptr_t) noexcept
+    {
+        reset();
+        return *this;
+    }
+
+    InplaceFunction(const InplaceFunction &) = delete;
+    InplaceFunction &operator=(const InplaceFunction &) = delete;
+
+    ~InplaceFunction() { reset(); }
+
+    R operator()(Args... args) const
+    {
+        if (ops_ == nullptr) throw std::bad_function_call();
+        return ops_->invoke(const_cast<Storage *>(&storage_), std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const noexcept { return ops_ != nullptr; }
+    bool operator==(std::nullptr_t) const noexcept { return ops_ == nullptr; }
+    bool operator!=(std::nullptr_t) const noexcept { return ops_ != nullptr; }
+
+private:
+    using Storage = typename std::aligned_storage<Capacity, alignof(std::max_align_t)>::type;
+
+    // 类型擦除后的操作表，每种可调用类型一份静态实例
+    struct Ops
+    {
+        R (*invoke)(void *, Args &&...);
+        void (*move)(void *dst, void *src) noexcept;
+        void (*destroy)(void *) noexcept;
+    };
+
+    template <typename Fn>
+    struct OpsFor
+    {
+        static R invoke(void *p, Args &&...args)
+        {
+            return (*static_cast<Fn *>(p))(std::forward<Args>(args)...);
+        }
+        static void move(void *dst, void *src) noexcept
+        {
+            ::new (dst) Fn(std::move(*static_cast<Fn *>(src)));
+            static_cast<Fn *>(src)->~Fn();
+        }
+        static void destroy(void *p) noexcept
+        {
+            static_cast<Fn *>(p)->~Fn();
+        }
+        static constexpr Ops ops = {&invoke, &move, &destroy};
+    };
+
+    // 空的std::function和函数指针构造出空的InplaceFunction
+    template <typename F>
+    static bool isNull(const F &) { return false; }
+    template <typename S>
+    static bool isNull(const std::function<S> &f) { return !f; }
+    template <typename Rt, typename... A>
+    static bool isNull(Rt (*f)(A...)) { return f == nullptr; }
+
+    void reset() noexcept
+    {
+        if (ops_ != nullptr)
+        {
+            ops_->destroy(&storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    Storage storage_;
+    const Ops *ops_;
+};
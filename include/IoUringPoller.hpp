@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <linux/io_uring.h>
+#include "Timestamp.hpp"
+#include "Poller.hpp"
+
+/*
+* 基于io_uring的IO复用实现，通过环境变量MUDUO_USE_URING启用
+* 1. 边沿触发的Channel使用multishot poll，注册一次后每次就绪都产生一个完成事件，不需要重新提交
+* 2. 水平触发的Channel使用单次poll，在下一轮poll时重新提交，重新提交时fd若仍然就绪会立即完成，与epoll的水平触发语义一致
+* 3. 本轮产生的所有提交请求和等待完成事件合并为一次io_uring_enter系统调用
+* 直接使用io_uring系统调用，不依赖liburing
+*/
+class IoUringPoller : public Poller
+{
+public:
+    IoUringPoller(EventLoop* loop);
+    ~IoUringPoller() override;
+
+    Timestamp poll(int timeoutMs, ChannelList* activeChannels) override;
+    void updateChannel(Channel* channel) override;
+    void removeChannel(Channel* channel) override;
+    bool supportsEdgeTriggered() const override { return true; }
+
+    // 内核是否支持本实现需要的io_uring特性，结果只探测一次
+    static bool isSupported();
+
+private:
+    static const unsigned kRingEntries = 256;
+
+    // 每个fd上poll请求的状态
+    struct PollState
+    {
+        Channel* channel;
+        uint32_t generation; // 提交中的poll请求的代数，0表示没有提交中的请求
+        int armedEvents;     // 提交中的poll请求监听的事件
+        bool multishot;      // 提交中的poll请求是否为multishot
+        bool dirty;          // 是否已在dirty_中等待同步
+        int revents;         // 本轮累计的就绪事件
+    };
+
+    void setupRing();
+    // 获取一个空闲的提交队列项，队列已满时先提交已有的请求
+    io_uring_sqe* getSqe();
+    // 尚未被内核取走的提交请求数
+    unsigned pendingSubmissions() const;
+    int enter(unsigned toSubmit, unsigned minComplete, unsigned flags, const void* arg, size_t argSize);
+
+    void markDirty(int fd, PollState& state);
+    // 把dirty_中Channel当前的监听事件同步为poll请求
+    void syncDirty();
+    void prepPollAdd(int fd, PollState& state, int events, bool multishot);
+    void prepPollRemove(int fd, uint32_t generation);
+    void reapCompletions(ChannelList* activeChannels);
+
+private:
+    int ringFd_;
+
+    // 提交队列
+    void* sqRing_;
+    size_t sqRingSize_;
+    unsigned* sqHead_;
+    unsigned* sqTail_;
+    unsigned sqMask_;
+    unsigned sqEntries_;
+    unsigned* sqArray_;
+    io_uring_sqe* sqes_;
+    size_t sqesSize_;
+    unsigned sqLocalTail_;   // 已填写但尚未发布给内核的队尾
+
+    // 完成队列，与提交队列共享一次mmap
+    unsigned* cqHead_;
+    unsigned* cqTail_;
+    unsigned cqMask_;
+    io_uring_cqe* cqes_;
+
+    uint32_t nextGeneration_;
+    std::unordered_map<int, PollState> states_;
+    std::vector<int> dirty_;
+    std::vector<PollState*> activeStates_;
+};
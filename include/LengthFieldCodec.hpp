@@ -0,0 +1,57 @@
+#pragma once
+#include <functional>
+#include <string_view>
+#include <vector>
+#include "noncopyable.hpp"
+#include "Callbacks.hpp"
+#include "Timestamp.hpp"
+
+class Buffer;
+
+/*
+* 长度前缀分帧：每帧由lengthFieldBytes字节的大端长度头和payload组成，长度不包含长度头本身
+* 接收时一次读事件中解析出的全部完整帧作为一批交给FramesCallback，帧以string_view的形式直接指向
+* 连接的输入Buffer，不拷贝；回调返回后才从Buffer中移除这些帧，不完整的帧留到下一次读事件
+* 发送时在Buffer的预留空间中原地写入长度头，payload不再为了拼接消息头拷贝一次
+* 只保存配置，可以在多个loop的连接之间共享
+*/
+class LengthFieldCodec : noncopyable
+{
+public:
+    using FrameList = std::vector<std::string_view>;
+    // frames只在回调期间有效，需要保留的帧由回调自行拷贝
+    using FramesCallback = std::function<void(const TcpConnectionPtr &, const FrameList &frames, Timestamp)>;
+    // 收到的长度超过maxFrameLength时调用，未设置时记录错误并关闭连接
+    using ErrorCallback = std::function<void(const TcpConnectionPtr &, uint64_t length)>;
+
+    static const size_t kDefaultMaxFrameLength = 64 * 1024 * 1024;
+
+    // lengthFieldBytes只能是1、2、4、8
+    explicit LengthFieldCodec(const FramesCallback &cb,
+                              int lengthFieldBytes = 4,
+                              size_t maxFrameLength = kDefaultMaxFrameLength);
+
+    void setErrorCallback(const ErrorCallback &cb) { errorCallback_ = cb; }
+    int lengthFieldBytes() const { return lengthFieldBytes_; }
+
+    // 作为TcpConnection的MessageCallback，如
+    // server.setMessageCallback(std::bind(&LengthFieldCodec::onMessage, &codec, _1, _2, _3))
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime) const;
+
+    // buf中的全部可读数据作为一帧发送，长度头原地写入buf的预留空间，调用后buf为空
+    // 长度超出长度头的表示范围或maxFrameLength时记录错误并返回false，不发送，buf保持不变
+    bool send(const TcpConnectionPtr &conn, Buffer *buf) const;
+    // 把payload拷贝到一个新的Buffer中再发送，长度检查同上
+    bool send(const TcpConnectionPtr &conn, std::string_view payload) const;
+
+private:
+    uint64_t peekLength(const char *data) const;
+    void prependLength(Buffer *buf, size_t length) const;
+    // 发送前检查帧长度，对端按同样的配置解析，超出范围的长度会被截断或拒绝，破坏整个流
+    bool checkSendLength(const TcpConnectionPtr &conn, size_t length) const;
+
+    FramesCallback framesCallback_;
+    ErrorCallback errorCallback_;
+    const int lengthFieldBytes_;
+    const size_t maxFrameLength_;
+};
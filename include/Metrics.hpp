@@ -0,0 +1,61 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/*
+* 运行时指标的基本类型
+* 每个计数器和直方图只有一个写者（所属的loop线程），写入只是relaxed的读和写，不需要原子的读-改-写
+* 其他线程可以随时读取，读取不加锁，对写者的影响只有缓存行共享
+*/
+
+// 单写者计数器加n
+inline void metricAdd(std::atomic<uint64_t> &counter, uint64_t n = 1)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+// 单写者计数器减n，用于表示当前量的指标
+inline void metricSub(std::atomic<uint64_t> &counter, uint64_t n)
+{
+    counter.store(counter.load(std::memory_order_relaxed) - n, std::memory_order_relaxed);
+}
+
+// 以2为底按微秒分桶的延迟直方图，第i个桶统计(2^(i-1), 2^i]微秒的样本，第0个桶统计<=1微秒的样本
+class LatencyHistogram
+{
+public:
+    static const int kBuckets = 26; // 最后一个桶的上界约为33秒，更大的样本也计入最后一个桶
+
+    void record(int64_t microseconds)
+    {
+        uint64_t us = microseconds > 0 ? static_cast<uint64_t>(microseconds) : 0;
+        int bucket = 0;
+        while (bucket < kBuckets - 1 && (1ULL << bucket) < us) ++bucket;
+        metricAdd(buckets_[bucket]);
+        metricAdd(count_);
+        metricAdd(sum_, us);
+    }
+
+    // 第i个桶的上界，单位为微秒
+    static uint64_t upperBound(int bucket) { return 1ULL << bucket; }
+
+    uint64_t bucket(int i) const { return buckets_[i].load(std::memory_order_relaxed); }
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> buckets_[kBuckets] = {};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};  // 微秒
+};
+
+// 以Prometheus文本格式输出指标，labels为不带花括号的标签列表，如 loop="0"
+namespace metrics
+{
+// 输出指标的HELP和TYPE行，每个指标名只需要输出一次
+void appendHeader(std::string *out, const char *name, const char *type, const char *help);
+void appendValue(std::string *out, const char *name, const std::string &labels, double value);
+// 直方图以秒为单位输出累计的桶、_sum和_count
+void appendHistogram(std::string *out, const char *name, const std::string &labels, const LatencyHistogram &histogram);
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "noncopyable.hpp"
+#include "InetAddress.hpp"
+#include "EventLoopThread.hpp"
+#include "Callbacks.hpp"
+
+class EventLoop;
+class TcpServer;
+class Buffer;
+
+/*
+* 以Prometheus文本格式输出运行时指标的管理端口
+* 运行在自己的EventLoop线程中，只读取各loop、Acceptor发布的原子计数器，不向IO线程投递任务，抓取不会干扰IO线程
+* GET /metrics返回全部指标，其他路径返回404，每个请求处理完后关闭连接
+* 被监控的TcpServer需要在addServer之前start，并且在MetricsServer销毁之后才能销毁
+*/
+class MetricsServer : noncopyable
+{
+public:
+    MetricsServer(const InetAddress &listenAddr, const std::string &name = "metrics");
+    ~MetricsServer();
+
+    // 需要在start之前调用
+    void addServer(TcpServer *server);
+    void start();
+
+    // 生成当前的全部指标，start之后线程安全
+    std::string render() const;
+
+private:
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime);
+
+    const InetAddress listenAddr_;
+    const std::string name_;
+    std::vector<TcpServer*> servers_;   // 被监控的服务器，start之后不再修改
+    EventLoopThread thread_;
+    EventLoop *loop_;                   // 管理端口的loop
+    std::unique_ptr<TcpServer> server_; // 只在loop_所在的线程中创建和销毁
+};
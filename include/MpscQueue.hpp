@@ -0,0 +1,138 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include "noncopyable.hpp"
+
+/*
+* 无锁的多生产者单消费者队列（Vyukov intrusive MPSC）
+* 链接指针与元素放在同一个节点中，push可以在任意线程中并发调用，只需要一次原子交换；pop和empty只能由唯一的消费者线程调用
+* 生产者交换head_之后、链接next之前的短暂窗口内，消费者会把队列视为空，调用者需要自行处理这种情况
+*
+* 节点循环使用：消费者把取空的节点压入freeList_，生产者在本线程的节点缓存用完时通过一次exchange取走整个空闲链表，
+* 只有整体取走、没有单个弹出，不存在ABA问题。稳定运行后push和pop都不再分配内存
+* 节点与具体的队列无关，同一元素类型的所有队列共用每个线程的节点缓存
+*/
+template <typename T>
+class MpscQueue : noncopyable
+{
+public:
+    // 空闲链表最多保留的节点数，超过时由消费者直接释放，突发流量之后不会一直占用内存
+    static const size_t kMaxFreeNodes = 4096;
+
+    MpscQueue() : head_(&stub_), tail_(&stub_), freeList_(nullptr), freeCount_(0) {}
+
+    ~MpscQueue()
+    {
+        T value;
+        while (pop(value)) {}
+        deleteChain(freeList_.exchange(nullptr, std::memory_order_acquire));
+    }
+
+    void push(T value)
+    {
+        Node *node = allocateNode();
+        node->value = std::move(value);
+        node->next.store(nullptr, std::memory_order_relaxed);
+        enqueue(node);
+    }
+
+    // 取出队首元素，队列为空时返回false
+    bool pop(T &value)
+    {
+        Node *tail = tail_;
+        Node *next = tail->next.load(std::memory_order_acquire);
+        if (tail == &stub_)
+        {
+            if (next == nullptr) return false;
+            tail_ = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next == nullptr)
+        {
+            // tail是最后一个节点，先把stub_放回队尾，才能取走tail
+            if (tail != head_.load(std::memory_order_acquire)) return false; // 有生产者正在入队
+            stub_.next.store(nullptr, std::memory_order_relaxed);
+            enqueue(&stub_);
+            next = tail->next.load(std::memory_order_acquire);
+            if (next == nullptr) return false;
+        }
+        tail_ = next;
+        value = std::move(tail->value);
+        recycleNode(tail);
+        return true;
+    }
+
+    bool empty() const
+    {
+        return tail_ == &stub_ && stub_.next.load(std::memory_order_acquire) == nullptr;
+    }
+
+private:
+    struct Node
+    {
+        std::atomic<Node *> next{nullptr};  // 在队列中时指向后一个节点，空闲时指向下一个空闲节点
+        T value;
+    };
+
+    // 生产者线程的节点缓存，线程退出时释放
+    struct NodeCache
+    {
+        Node *head = nullptr;
+        ~NodeCache() { deleteChain(head); }
+    };
+
+    static void deleteChain(Node *node)
+    {
+        while (node != nullptr)
+        {
+            Node *next = node->next.load(std::memory_order_relaxed);
+            delete node;
+            node = next;
+        }
+    }
+
+    Node *allocateNode()
+    {
+        static thread_local NodeCache cache;
+        if (cache.head == nullptr && freeList_.load(std::memory_order_relaxed) != nullptr)
+        {
+            cache.head = freeList_.exchange(nullptr, std::memory_order_acquire);
+            freeCount_.store(0, std::memory_order_relaxed);
+        }
+        Node *node = cache.head;
+        if (node == nullptr) return new Node;
+        cache.head = node->next.load(std::memory_order_relaxed);
+        return node;
+    }
+
+    // 只由消费者调用
+    void recycleNode(Node *node)
+    {
+        node->value = T();  // 及时释放元素持有的资源
+        if (freeCount_.load(std::memory_order_relaxed) >= kMaxFreeNodes)
+        {
+            delete node;
+            return;
+        }
+        freeCount_.fetch_add(1, std::memory_order_relaxed);
+        Node *top = freeList_.load(std::memory_order_relaxed);
+        do
+        {
+            node->next.store(top, std::memory_order_relaxed);
+        } while (!freeList_.compare_exchange_weak(top, node, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    void enqueue(Node *node)
+    {
+        Node *prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    std::atomic<Node *> head_; // 生产者入队的位置
+    Node *tail_;               // 消费者出队的位置，只由消费者访问
+    Node stub_;
+    std::atomic<Node *> freeList_;      // 消费者归还的空闲节点
+    std::atomic<size_t> freeCount_;     // freeList_中节点数的近似值
+};
@@ -0,0 +1,67 @@
+#pragma once
+#include <deque>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+#include "noncopyable.hpp"
+
+/*
+* TcpConnection的输出队列，由多个数据段组成
+* 数据段可以是队列自己持有的内存，也可以是引用计数共享的只读数据的一个切片，或者文件中的一段
+* 内存数据段通过writev一次提交多个，文件数据段通过sendfile从页缓存直接发送，各数据段严格按加入的顺序发送
+* 部分发送只移动队首数据段的偏移，不会搬移或重新分配已有数据
+*/
+class OutputQueue : noncopyable
+{
+public:
+    // 小数据段合并到队尾的上限，超过后新建数据段，避免大数据段反复扩容
+    static const size_t kMaxCoalesceSize = 64 * 1024;
+    // 转移所有权的数据小于该值时直接拷贝合并
+    static const size_t kMinMoveSize = 1024;
+
+    OutputQueue() : readableBytes_(0) {}
+
+    // 待发送的字节数
+    size_t readableBytes() const { return readableBytes_; }
+    bool empty() const { return readableBytes_ == 0; }
+    // 队首是否为文件数据段，writeFd在文件数据段上出错时连接无法继续发送
+    bool frontIsFile() const { return !segments_.empty() && segments_.front().isFile(); }
+    // 数据段个数
+    size_t segments() const { return segments_.size(); }
+
+    // 拷贝data到队列持有的内存中，小数据会合并到队尾的数据段
+    void append(const char *data, size_t len);
+    // 接管data的所有权，从offset开始的数据为待发送数据，小数据仍然会合并到队尾
+    void append(std::string &&data, size_t offset = 0);
+    // 引用共享数据中[offset, offset + len)的部分，不拷贝数据
+    void append(std::shared_ptr<const std::string> data, size_t offset, size_t len);
+    // 文件fd中[offset, offset + len)的部分，owner在数据段发送完或被丢弃之前保持fd打开，为空时由调用者保证
+    void appendFile(int fd, off_t offset, size_t len, std::shared_ptr<const void> owner);
+
+    // 丢弃队首len字节已发送的数据
+    void retrieve(size_t len);
+    void retrieveAll();
+
+    // 写出队首的数据，不会移除已写入的数据：队首是文件数据段时调用一次sendfile，
+    // 否则通过writev写出队首最多IOV_MAX个连续的内存数据段，其后是文件数据段时带MSG_MORE，fd必须是socket
+    // attempted不为空时返回本次提交的字节数
+    ssize_t writeFd(int fd, int *saveErrno, size_t *attempted = nullptr) const;
+
+private:
+    struct Segment
+    {
+        std::string owned;                          // 队列持有的数据
+        std::shared_ptr<const std::string> shared;  // 共享的数据，不为空时表示该段是切片
+        int fileFd = -1;                            // 不为-1时表示该段是文件的一部分
+        std::shared_ptr<const void> fileOwner;      // 保持fileFd打开
+        size_t offset;                              // 未发送数据在owned、shared或文件中的起始位置
+        size_t len;                                 // 未发送的字节数
+
+        bool isFile() const { return fileFd >= 0; }
+        const char *data() const { return (shared ? shared->data() : owned.data()) + offset; }
+    };
+
+private:
+    std::deque<Segment> segments_;
+    size_t readableBytes_;
+};
@@ -0,0 +1,26 @@
+#pragma once
+#include <vector>
+#include <poll.h>
+#include "Timestamp.hpp"
+#include "Poller.hpp"
+
+// 基于poll(2)的IO复用实现，只支持水平触发，通过环境变量MUDUO_USE_POLL启用
+class PollPoller : public Poller
+{
+public:
+    PollPoller(EventLoop* loop);
+    ~PollPoller() override = default;
+
+    Timestamp poll(int timeoutMs, ChannelList* activeChannels) override;
+    void updateChannel(Channel* channel) override;
+    void removeChannel(Channel* channel) override;
+
+private:
+    // 填写活跃的连接
+    void fillActiveChannels(int numEvents, ChannelList* activeChannels) const;
+
+private:
+    using PollFdList = std::vector<struct pollfd>;
+
+    PollFdList pollfds_; // Channel的index即其在pollfds_中的下标
+};
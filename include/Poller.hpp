@@ -4,6 +4,7 @@
 #include <unordered_map>
 #include "noncopyable.hpp"
 #include "Timestamp.hpp"
+#include "TraceRing.hpp"
 
 class Channel;
 class EventLoop;
@@ -25,14 +26,19 @@ public:
     virtual Timestamp poll(int timeoutMs, ChannelList* activeChannels) = 0;
     virtual void updateChannel(Channel *channel) = 0;
     virtual void removeChannel(Channel *channel) = 0;
+    // 是否支持Channel的边沿触发模式，不支持时Channel退化为水平触发
+    virtual bool supportsEdgeTriggered() const { return false; }
 
     // 判断参数的Channel是否在当前的Poller中
     bool hasChannel(Channel* Channel) const;
 
     // EventLoop可以通过该接口获取默认的IO复用的具体实现
+    // 默认使用epoll，设置环境变量MUDUO_USE_POLL使用poll，设置MUDUO_USE_URING使用io_uring
     static Poller *newDefaultPoller(EventLoop* loop);
 
 protected:
+    TraceRing &traceRing() const;
+
     using ChannelMap = std::unordered_map<int, Channel*>;
     ChannelMap channels_;
 
@@ -0,0 +1,38 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <string_view>
+#include "FileCache.hpp"
+#include "HttpRequest.hpp"
+#include "HttpResponse.hpp"
+
+/*
+* 静态文件请求处理，可以直接作为HttpServer的请求回调
+* 请求路径映射到root目录下的文件，以'/'结尾的路径映射到其中的index.html，包含".."的路径返回403
+* 文件通过FileCache打开，响应体是文件的一段，由sendfile发送，不经过用户态缓冲区
+* 支持GET和HEAD、If-Modified-Since以及单个区间的Range请求，多区间请求按完整文件返回
+*/
+class StaticFileHandler
+{
+public:
+    // cache为空时创建一个默认大小的缓存，多个handler可以共享同一个缓存
+    explicit StaticFileHandler(const std::string &root, std::shared_ptr<FileCache> cache = nullptr);
+
+    void operator()(const HttpRequest &request, HttpResponse *response) const;
+
+    const std::string &root() const { return root_; }
+    FileCache &cache() const { return *cache_; }
+
+    // 按扩展名返回Content-Type，未知的扩展名返回application/octet-stream
+    static const char *contentTypeOf(std::string_view path);
+
+private:
+    // 解码请求路径中的%XX并检查是否越出root，失败时返回false
+    static bool decodePath(std::string_view path, std::string *out);
+    // 解析Range请求头，返回1表示得到有效区间，0表示忽略该请求头，-1表示区间无法满足
+    static int parseRange(std::string_view range, off_t size, off_t *first, off_t *last);
+    static std::string httpDate(time_t t);
+
+    std::string root_;
+    std::shared_ptr<FileCache> cache_;
+};
@@ -0,0 +1,75 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <string>
+#include "noncopyable.hpp"
+#include "Callbacks.hpp"
+#include "Connector.hpp"
+#include "TcpConnection.hpp"
+
+class EventLoop;
+
+/*
+* 客户端连接，与TcpServer产生同样的TcpConnection，使用同样的回调和loop中的Buffer内存池
+* 一个TcpClient同一时刻最多持有一个连接，enableRetry后连接断开时自动重连
+* connect/disconnect/stop/connection线程安全，TcpClient需要在loop线程中销毁
+*/
+class TcpClient : noncopyable
+{
+public:
+    TcpClient(EventLoop *loop, const InetAddress &serverAddr, const std::string &nameArg);
+    ~TcpClient();
+
+    void connect();     // 开始连接，失败时按退避延迟重试
+    void disconnect();  // 半关闭当前连接，不再重连
+    void stop();        // 停止尚未完成的连接和重试
+
+    TcpConnectionPtr connection() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return connection_;
+    }
+
+    EventLoop *getLoop() const { return loop_; }
+    const std::string &name() const { return name_; }
+    bool retry() const { return retry_; }
+    // 连接建立后断开时重新连接
+    void enableRetry() { retry_ = true; }
+    // 连接失败时重试的初始延迟和最大延迟，单位为秒
+    void setRetryDelay(double initial, double max) { connector_->setRetryDelay(initial, max); }
+
+    // 以下设置在下一次建立连接时生效，含义与TcpServer中的同名函数相同
+    void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
+    void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
+    void setWriteCompleteCallback(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb; }
+    void setIdleTimeout(double seconds) { idleTimeout_ = seconds; }
+    void setReadBudget(size_t bytes) { readBudget_ = bytes; }
+    void setBackpressure(size_t highMark, size_t lowMark)
+    { backpressureHigh_ = highMark; backpressureLow_ = TcpConnection::clampBackpressureLow(highMark, lowMark); }
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+
+private:
+    // Connector连接成功后在loop线程中调用
+    void newConnection(int sockfd);
+    void removeConnection(const TcpConnectionPtr &conn);
+
+private:
+    EventLoop *loop_;
+    ConnectorPtr connector_;
+    const std::string name_;
+
+    ConnectionCallback connectionCallback_;
+    MessageCallback messageCallback_;
+    WriteCompleteCallback writeCompleteCallback_;
+    double idleTimeout_;
+    size_t readBudget_;
+    size_t backpressureHigh_;
+    size_t backpressureLow_;
+    bool edgeTriggered_;
+
+    std::atomic<bool> retry_;
+    std::atomic<bool> connect_;
+    int nextConnId_;                    // 只在loop线程中访问
+    mutable std::mutex mutex_;
+    TcpConnectionPtr connection_;       // 由mutex_保护
+};
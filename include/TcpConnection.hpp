@@ -1,5 +1,6 @@
 #pragma once
 
+#include <any>
 #include <memory>
 #include <string>
 #include <atomic>
@@ -7,7 +8,9 @@
 #include "InetAddress.hpp"
 #include "Callbacks.hpp"
 #include "Buffer.hpp"
+#include "OutputQueue.hpp"
 #include "Timestamp.hpp"
+#include "TimingWheel.hpp"
 
 class Channel;
 class EventLoop;
@@ -32,10 +35,28 @@ public:
 
     bool connected() const { return state_ == kConnected; }
 
+    // 发送数据，线程安全
     void send(const std::string &buf);
-    void sendFile(int fd, off_t offset, size_t count);
+    void send(std::string &&buf);   // 转移buf的所有权，不拷贝数据
+    void send(Buffer *buf);         // 发送buf中的全部可读数据，调用后buf为空
+    void send(const std::shared_ptr<const std::string> &buf); // 共享只读数据，不拷贝
+    // 发送文件fd中[offset, offset + count)的部分，零拷贝，与其他send的数据保持顺序
+    // 发送不完的部分留在输出队列中，等待可写事件后继续；owner在发送完之前保持fd打开，为空时由调用者保证
+    void sendFile(int fd, off_t offset, size_t count, std::shared_ptr<const void> owner = nullptr);
 
     void shutdown(); // 半关闭
+    void forceClose(); // 强制关闭连接，线程安全
+    void setTcpNoDelay(bool on); // 禁用Nagle算法，小消息立即发出
+
+    // 只能在loop线程中调用。cork之后send只把数据追加到输出队列，uncork时通过一次writev发出
+    // 用于一次读事件中处理多个请求时合并所有响应，如HTTP pipelining
+    void cork() { corked_ = true; }
+    void uncork();
+
+    // 上层协议的连接状态，如HTTP解析器，只能在loop线程中访问
+    void setContext(const std::any &context) { context_ = context; }
+    std::any *getMutableContext() { return &context_; }
+    const std::any &getContext() const { return context_; }
 
     void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
     void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
@@ -43,6 +64,36 @@ public:
     void setCloseCallback(const CloseCallback &cb) { closeCallback_ = cb; }
     void setHighWaterMarkback(const HighWaterMarkCallback &cb, size_t highWaterMark) 
     { highWaterMarkCallback_ = cb; highWaterMark_ = highWaterMark;}
+    // 设置空闲超时时间，单位为秒，超过该时间没有读写活动的连接会被强制关闭，<=0表示不启用
+    // 需要在connectEstablished之前调用
+    void setIdleTimeout(double seconds) { idleTimeout_ = seconds; }
+    // 设置一次读事件中最多读取的字节数
+    void setReadBudget(size_t bytes) { readBudget_ = bytes; }
+
+    // 使用边沿触发模式，需要在connectEstablished之前调用
+    void setEdgeTriggered(bool on);
+
+    // 开始/停止读取，线程安全，停止期间数据留在内核接收缓冲区中，由TCP流量控制限制对端的发送
+    void startRead();
+    void stopRead();
+    bool isReading() const { return reading_; }
+
+    // 自动背压：输出队列达到highMark时暂停源连接的读取，降到lowMark以下时恢复，highMark为0表示不启用
+    // 源连接默认为本连接；代理场景下设置为上游连接，下游发送慢时暂停从上游读取，两者可以在不同的loop中
+    // lowMark必须小于highMark，否则按clampBackpressureLow修正
+    void setBackpressure(size_t highMark, size_t lowMark);
+    // lowMark >= highMark时暂停后会立即恢复，每次写入都在暂停和恢复之间来回切换，此时记录警告并改为highMark的一半
+    static size_t clampBackpressureLow(size_t highMark, size_t lowMark);
+    void setBackpressureSource(const TcpConnectionPtr &source) { backpressureSource_ = source; hasBackpressureSource_ = true; }
+
+    // 连接的统计信息，只能在loop线程中读取
+    uint64_t bytesReceived() const { return bytesReceived_; }
+    uint64_t bytesSent() const { return bytesSent_; }
+    size_t outputBacklog() const { return outputQueue_.readableBytes(); }
+
+    static constexpr size_t kDefaultReadBudget = 256 * 1024;
+    // 一次可写事件最多写出的字节数，避免一个连接占用loop太久
+    static constexpr size_t kWriteBudget = 1024 * 1024;
 
     void connectEstablished();  // 建立连接
     void connectDestroyed();    // 销毁连接
@@ -62,14 +113,41 @@ private:
     void handleError();
 
     void sendInLoop(const void* data, size_t len);
+    void sendStringInLoop(std::string &data);
+    void sendSharedInLoop(const std::shared_ptr<const std::string> &data);
+    size_t writeDirectly(const void* data, size_t len, bool *faultError);
+    void queueOutput(size_t oldLen);
     void shutdownInLoop();
-    void sendFileInLoop(int fileDescriptor, off_t offset, size_t count);
+    void forceCloseInLoop();
+    void touchIdleEntry(); // 有读写活动时刷新空闲超时
+    void adaptReadHint(size_t bytes);
+    void sendFileInLoop(int fileDescriptor, off_t offset, size_t count, const std::shared_ptr<const void> &owner);
+    void recordWrite(size_t n); // 更新本连接和loop的写统计
+    // 输出队列中的数据已经全部写出，通知上层并完成挂起的半关闭
+    void outputDrained();
+    // 写出输出队列中的数据，返回写出的字节数，因kWriteBudget停止时设置*budgetExhausted
+    size_t drainOutput(bool *budgetExhausted);
+    // 把WriteCompleteCallback加入loop，合并同一轮中的多次通知
+    void notifyWriteComplete();
+    // 根据reading_和readHolds_打开或关闭读事件，只能在loop线程中调用
+    void updateReading();
+    void setReadingInLoop(bool on);
+    // 其他连接因背压暂停/恢复本连接的读取，线程安全，可以叠加
+    void holdRead();
+    void releaseRead();
+    void adjustReadHolds(int delta);
+    // 输出队列长度变化后检查是否需要暂停或恢复源连接的读取
+    void checkBackpressure();
        
 private:
     EventLoop* loop_;   // 单Reactor模式：指向mainloop，多Reacto：指向subloop
     const std::string name_;
     std::atomic_int state_;
-    bool reading_;      // 表示连接是否在监听读事件
+    bool reading_;      // 上层是否希望读取
+    int readHolds_;     // 因背压暂停本连接读取的次数，不为0时不读取
+    bool closed_;       // 连接已关闭，不再注册读事件
+    bool corked_;       // 暂存发送的数据，uncork时一起写出
+    bool writeCompletePending_; // 已经加入loop但尚未执行的WriteCompleteCallback
 
     // 与Acceptor类似
     std::unique_ptr<Socket> socket_;
@@ -85,7 +163,27 @@ private:
     HighWaterMarkCallback highWaterMarkCallback_;   // 高水平回调
     size_t highWaterMark_;                          // 高水位阈值, 用于​​防止发送方因数据发送过快而导致接收方缓冲区溢出
 
+    double idleTimeout_;                            // 空闲超时时间，单位为秒
+    TimingWheel::Entry *idleEntry_;                 // 在loop_的时间轮中的条目
+
+    static constexpr size_t kMinReadHint = Buffer::INIT_SIZE;
+    static constexpr size_t kMaxReadHint = 128 * 1024;
+    size_t readHint_;                               // 下一次读取前保证inputBuffer_至少有的可写空间
+    int readShrinkCount_;                           // 连续读取量不足readHint_一半的次数
+    size_t readBudget_;                             // 一次读事件最多读取的字节数
+    uint64_t bytesReceived_;                        // 累计读取的字节数
+    uint64_t bytesSent_;                            // 累计写出的字节数
+
+    size_t backpressureHigh_;                       // 暂停源连接读取的输出队列长度，0表示不启用
+    size_t backpressureLow_;                        // 恢复源连接读取的输出队列长度
+    std::weak_ptr<TcpConnection> backpressureSource_;   // 背压作用的连接
+    bool hasBackpressureSource_;                    // 为false时背压作用于本连接
+    std::weak_ptr<TcpConnection> heldSource_;       // 当前被本连接暂停读取的连接
+    bool backpressureActive_;
+
+    std::any context_;
+
     // 数据缓冲区
     Buffer inputBuffer_;
-    Buffer outputBuffer_;
+    OutputQueue outputQueue_;   // 待发送数据，按顺序由内存和文件数据段组成，通过writev和sendfile发送
 };
\ No newline at end of file
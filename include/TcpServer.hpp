@@ -5,6 +5,7 @@
 #include <memory>
 #include <atomic>
 #include <unordered_map>
+#include <vector>
 #include "EventLoop.hpp"
 #include "Acceptor.hpp"
 #include "InetAddress.hpp"
@@ -20,11 +21,28 @@ class TcpServer
 public:
     using ThreadInitCallback = std::function<void(EventLoop*)>;
 
+    // 所有Acceptor的accept统计之和
+    struct AcceptTotals
+    {
+        uint64_t accepted;
+        uint64_t shed;
+        uint64_t errors;
+        uint64_t batches;
+    };
+
     enum Option
     {
         kNoReusePort,
         KReusePort,
     };
+
+    // 新连接的accept方式
+    enum AcceptMode
+    {
+        kSingleAcceptor,    // baseLoop中的一个Acceptor负责accept，再轮询分配给subloop
+        kReusePortPerLoop,  // 每个subloop通过SO_REUSEPORT绑定自己的监听socket，由内核分配连接，直接在本loop中accept
+        kSharedListener,    // 所有subloop以EPOLLEXCLUSIVE监听同一个socket，被唤醒的loop直接accept
+    };
     
     TcpServer(EventLoop *loop,
               const InetAddress &listenAddr,
@@ -38,19 +56,73 @@ public:
     void setWriteCompleteCallbakc(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb; }
 
     void setThreadNum(int numThreads);
+    // subloop线程的cpu亲和性和NUMA本地内存，绑定结果可以在ThreadInitCallback中通过EventLoop::cpu()/numaNode()获取
+    void setCpuAffinity(const std::vector<std::vector<int>> &cpuSets) { threadPool_->setCpuAffinity(cpuSets); }
+    void setNumaLocal(bool on) { threadPool_->setNumaLocal(on); }
+    // 设置连接的空闲超时时间，单位为秒，超时未读写的连接会被强制关闭，<=0表示不启用
+    void setIdleTimeout(double seconds) { idleTimeout_ = seconds; }
+    // 设置每个连接一次读事件中最多读取的字节数
+    void setReadBudget(size_t bytes) { readBudget_ = bytes; }
+    // 连接输出队列达到highMark时暂停读取该连接，降到lowMark以下时恢复，highMark为0表示不启用，lowMark需小于highMark
+    void setBackpressure(size_t highMark, size_t lowMark)
+    { backpressureHigh_ = highMark; backpressureLow_ = TcpConnection::clampBackpressureLow(highMark, lowMark); }
+    // 连接使用边沿触发模式，连接建立时注册一次EPOLLIN|EPOLLOUT|EPOLLET，之后读写不再调用epoll_ctl
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+    // 设置新连接选择subloop的策略，只在kSingleAcceptor模式下生效，多Acceptor模式下连接总是留在accept它的loop中
+    void setLoopSelectPolicy(EventLoopThreadPool::SelectPolicy policy) { threadPool_->setSelectPolicy(policy); }
+    void setLoopSelector(const EventLoopThreadPool::LoopSelector &selector) { threadPool_->setLoopSelector(selector); }
+    // 设置accept方式，需要在start之前调用
+    void setAcceptMode(AcceptMode mode) { acceptMode_ = mode; }
+    // 设置每个Acceptor一次读事件中最多accept的连接数，需要在start之前调用
+    void setAcceptBatch(int n) { acceptBatch_ = n; }
 
     void start(); // 启动监听
+
+    const std::string &name() const { return name_; }
+    const std::string &ipPort() const { return ipPort_; }
+
+    // 所有subloop中的连接总数，线程安全
+    size_t numConnections() const;
+    // 处理连接的loop，按线程池中的顺序排列，start之后不再变化，线程安全
+    std::vector<EventLoop*> loops() const;
+    // start之后线程安全
+    AcceptTotals acceptTotals() const;
+    // 在每个连接所属的loop线程中对其调用cb，异步执行，调用返回时cb可能尚未执行
+    void forEachConnection(const std::function<void(const TcpConnectionPtr &)> &cb);
     
 private:
-    void newConnection(int sockfd, const InetAddress &peerAddr);
-    void removeConnection(const TcpConnectionPtr &conn);
-    void removeConnectionInLoop(const TcpConnectionPtr &conn);    
+    using ConnectionMap = std::unordered_map<std::string, TcpConnectionPtr>;
+
+    // 每个loop持有自己的连接表，连接的建立和关闭都在所属的subloop中完成，不经过baseLoop
+    struct ConnectionShard
+    {
+        explicit ConnectionShard(EventLoop *ownerLoop) : loop(ownerLoop), count(0) {}
+
+        EventLoop *loop;
+        std::unique_ptr<Acceptor> acceptor; // 多Acceptor模式下本loop的Acceptor
+        ConnectionMap connections;  // 只在loop所在的线程中访问
+        std::atomic<size_t> count;  // connections的大小，供其他线程读取
+    };
+    using ConnectionShardPtr = std::shared_ptr<ConnectionShard>;
+
+    // Acceptor一次读事件accept到的一批连接，ioLoop为空时轮询选择subloop（baseLoop的Acceptor），
+    // 否则全部交给ioLoop（多Acceptor模式下Acceptor在ioLoop中直接调用）
+    // 同一个subloop的连接合并为一个任务投递，每批连接对每个loop只唤醒一次
+    void newConnections(EventLoop *ioLoop, const Acceptor::AcceptedList &accepted);
+    TcpConnectionPtr createConnection(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr);
+    // 在连接所属的loop中登记并建立连接
+    static void establishConnections(const ConnectionShardPtr &shard, const std::vector<TcpConnectionPtr> &conns);
+    // 在每个subloop中创建Acceptor并开始监听
+    void startLoopAcceptors();
+    // 在连接所属的loop中执行，只依赖连接表分片，TcpServer析构之后仍然可以安全调用
+    static void removeConnection(const std::weak_ptr<ConnectionShard> &weakShard, const TcpConnectionPtr &conn);
+    const ConnectionShardPtr &shardOf(EventLoop *loop) const;
 
 private:
-    using ConnectionMap = std::unordered_map<std::string, TcpConnectionPtr>;
 
     EventLoop *loop_;  //baseLoop
 
+    const InetAddress listenAddr_;
     const std::string ipPort_;
     const std::string name_;
 
@@ -65,6 +137,16 @@ private:
     ThreadInitCallback threadInitCallback_;         //线程初始化回调函数
     int numThreads_;                                //线程池线程数量
     std::atomic_int started_;
-    int nextConnId_;
-    ConnectionMap connections_;                     //保存所有连接 
+    std::atomic_int nextConnId_;                    //多Acceptor模式下会在多个loop中并发分配
+    double idleTimeout_;                            //连接空闲超时时间
+    size_t readBudget_;                             //连接单次读事件的读取上限
+    bool edgeTriggered_;                            //连接是否使用边沿触发模式
+    size_t backpressureHigh_;                       //连接的背压阈值
+    size_t backpressureLow_;
+    AcceptMode acceptMode_;                         //新连接的accept方式
+    int acceptBatch_;                               //Acceptor单次读事件的accept上限
+    // 按loop分片的连接表，start()之后不再修改，可以在任意线程中查找
+    std::unordered_map<EventLoop*, ConnectionShardPtr> shards_;
+    // 所有Acceptor的统计，start()之后不再修改，Acceptor销毁后仍然有效
+    std::vector<std::shared_ptr<Acceptor::Stats>> acceptStats_;
 };
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+#include <atomic>
+#include "noncopyable.hpp"
+#include "Timestamp.hpp"
+#include "Callbacks.hpp"
+
+// 定时器，保存到期时间、回调函数以及重复间隔
+class Timer : noncopyable
+{
+public:
+    Timer(TimerCallback cb, Timestamp when, double interval)
+        : callback_(std::move(cb)),
+          expiration_(when),
+          interval_(interval),
+          repeat_(interval > 0.0),
+          sequence_(++numCreated_)
+    {
+    }
+
+    void run() const { callback_(); }
+
+    Timestamp expiration() const { return expiration_; }
+    bool repeat() const { return repeat_; }
+    int64_t sequence() const { return sequence_; }
+
+    // 重复定时器在每次到期后重新计算下一次到期时间
+    void restart(Timestamp now);
+
+    static int64_t numCreated() { return numCreated_; }
+
+private:
+    const TimerCallback callback_;  // 定时器到期的回调函数
+    Timestamp expiration_;          // 到期时间
+    const double interval_;         // 重复间隔，单位为秒，<=0表示一次性定时器
+    const bool repeat_;
+    const int64_t sequence_;        // 全局唯一的序号，用于区分地址相同的不同定时器
+
+    static std::atomic<int64_t> numCreated_;
+};
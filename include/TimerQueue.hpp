@@ -0,0 +1,56 @@
+#pragma once
+#include <set>
+#include <vector>
+#include <memory>
+#include "noncopyable.hpp"
+#include "Timestamp.hpp"
+#include "Callbacks.hpp"
+#include "Channel.hpp"
+
+class EventLoop;
+class Timer;
+class TimerId;
+
+/*
+* 定时器队列，每个EventLoop拥有一个
+* 通过timerfd将定时事件转化为可读事件注册到Poller中，与其他IO事件统一在loop线程中处理
+* 所有定时器按到期时间有序存放，timerfd总是被设置为最早到期的时间
+*/
+class TimerQueue : noncopyable
+{
+public:
+    explicit TimerQueue(EventLoop *loop);
+    ~TimerQueue();
+
+    // 添加定时器，线程安全，可以在其他线程中调用
+    TimerId addTimer(TimerCallback cb, Timestamp when, double interval);
+    // 取消定时器，线程安全
+    void cancel(TimerId timerId);
+
+private:
+    using Entry = std::pair<Timestamp, Timer*>;
+    using TimerList = std::set<Entry>;
+    using ActiveTimer = std::pair<Timer*, int64_t>;
+    using ActiveTimerSet = std::set<ActiveTimer>;
+
+    void addTimerInLoop(Timer *timer);
+    void cancelInLoop(TimerId timerId);
+    // timerfd可读时的回调，执行所有到期的定时器
+    void handleRead();
+    // 取出所有到期的定时器
+    std::vector<Entry> getExpired(Timestamp now);
+    // 重新插入需要重复执行的定时器，并重新设置timerfd
+    void reset(const std::vector<Entry> &expired, Timestamp now);
+    // 插入定时器，返回最早到期时间是否发生了变化
+    bool insert(Timer *timer);
+
+private:
+    EventLoop *loop_;
+    const int timerfd_;
+    Channel timerfdChannel_;
+    TimerList timers_;              // 按到期时间排序的定时器
+
+    ActiveTimerSet activeTimers_;   // 按Timer地址排序的定时器，与timers_保存相同的内容，用于取消定时器
+    bool callingExpiredTimers_;     // 是否正在执行到期定时器的回调
+    ActiveTimerSet cancelingTimers_;// 在执行回调期间被取消的定时器，避免重复定时器被重新插入
+};
@@ -2,15 +2,92 @@
 
 #include <iostream>
 #include <string>
+#include <cstdint>
 
+// 纳秒精度的时间间隔，只有一个int64_t，按值传递
+class Duration
+{
+public:
+    constexpr Duration() : nanoseconds_(0) {}
+    constexpr explicit Duration(int64_t nanoseconds) : nanoseconds_(nanoseconds) {}
+
+    static constexpr Duration nanoseconds(int64_t n) { return Duration(n); }
+    static constexpr Duration microseconds(int64_t n) { return Duration(n * 1000); }
+    static constexpr Duration milliseconds(int64_t n) { return Duration(n * 1000 * 1000); }
+    static constexpr Duration seconds(double s) { return Duration(static_cast<int64_t>(s * 1e9)); }
+
+    constexpr int64_t nanoseconds() const { return nanoseconds_; }
+    constexpr int64_t microseconds() const { return nanoseconds_ / 1000; }
+    constexpr int64_t milliseconds() const { return nanoseconds_ / (1000 * 1000); }
+    constexpr double seconds() const { return static_cast<double>(nanoseconds_) / 1e9; }
+
+    Duration &operator+=(Duration d) { nanoseconds_ += d.nanoseconds_; return *this; }
+    Duration &operator-=(Duration d) { nanoseconds_ -= d.nanoseconds_; return *this; }
+
+private:
+    int64_t nanoseconds_;
+};
+
+inline constexpr Duration operator+(Duration lhs, Duration rhs) { return Duration(lhs.nanoseconds() + rhs.nanoseconds()); }
+inline constexpr Duration operator-(Duration lhs, Duration rhs) { return Duration(lhs.nanoseconds() - rhs.nanoseconds()); }
+inline constexpr bool operator<(Duration lhs, Duration rhs) { return lhs.nanoseconds() < rhs.nanoseconds(); }
+inline constexpr bool operator==(Duration lhs, Duration rhs) { return lhs.nanoseconds() == rhs.nanoseconds(); }
+
+// 微秒精度的时间戳（CLOCK_REALTIME），通过vDSO读取，不陷入内核
+// EventLoop在每次poll返回时读取一次，作为本轮所有事件的receiveTime
 class Timestamp
 {
 public:
     Timestamp();
-    explicit Timestamp(int64_t secondsSinceEpoch);
+    explicit Timestamp(int64_t microSecondsSinceEpoch);
     static Timestamp now();
-    std::string toString() const;  // 将sencodsSinceEpoch转化为对应的本地时间
+    // 单调时钟（CLOCK_MONOTONIC）的当前读数，不受系统时间调整影响，用于测量耗时
+    static Duration monotonic();
+    std::string toString() const;  // 将microSecondsSinceEpoch转化为对应的本地时间，精确到秒
+    // 格式为"YYYY/MM/DD HH:MM:SS[.uuuuuu]"，秒以上的部分按线程缓存，同一秒内只需格式化微秒
+    std::string toFormattedString(bool showMicroseconds = true) const;
+
+    bool valid() const { return microSecondsSinceEpoch_ > 0; }
+    int64_t microSecondsSinceEpoch() const { return microSecondsSinceEpoch_; }
+    time_t secondsSinceEpoch() const { return static_cast<time_t>(microSecondsSinceEpoch_ / kMicroSecondsPerSecond); }
+
+    static const int kMicroSecondsPerSecond = 1000 * 1000;
 
 private:
-    int64_t secondsSinceEopch_;
-};
\ No newline at end of file
+    int64_t microSecondsSinceEpoch_;
+};
+
+inline bool operator<(Timestamp lhs, Timestamp rhs)
+{
+    return lhs.microSecondsSinceEpoch() < rhs.microSecondsSinceEpoch();
+}
+
+inline bool operator==(Timestamp lhs, Timestamp rhs)
+{
+    return lhs.microSecondsSinceEpoch() == rhs.microSecondsSinceEpoch();
+}
+
+// 返回两个时间点的间隔，单位为秒
+inline double timeDifference(Timestamp high, Timestamp low)
+{
+    int64_t diff = high.microSecondsSinceEpoch() - low.microSecondsSinceEpoch();
+    return static_cast<double>(diff) / Timestamp::kMicroSecondsPerSecond;
+}
+
+// 在timestamp的基础上增加seconds秒
+inline Timestamp addTime(Timestamp timestamp, double seconds)
+{
+    int64_t delta = static_cast<int64_t>(seconds * Timestamp::kMicroSecondsPerSecond);
+    return Timestamp(timestamp.microSecondsSinceEpoch() + delta);
+}
+
+// 两个时间点的间隔
+inline Duration operator-(Timestamp high, Timestamp low)
+{
+    return Duration::microseconds(high.microSecondsSinceEpoch() - low.microSecondsSinceEpoch());
+}
+
+inline Timestamp operator+(Timestamp timestamp, Duration d)
+{
+    return Timestamp(timestamp.microSecondsSinceEpoch() + d.microseconds());
+}
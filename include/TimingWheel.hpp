@@ -0,0 +1,70 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <vector>
+#include "noncopyable.hpp"
+#include "TimerId.hpp"
+
+class EventLoop;
+
+/*
+* 哈希时间轮，每个EventLoop拥有一个，用于管理大量连接的空闲超时
+* 时间被划分为固定长度的tick，每个槽位是一个侵入式双向链表，条目按到期tick哈希到槽位中，
+* 超过一圈的到期时间在槽位被扫描时根据到期tick判断，因此超时时长不受槽位数量限制
+*
+* 添加、删除、刷新均为O(1)：刷新只记录新的到期tick，不移动链表节点，
+* 等旧槽位被扫描到时再把条目挂到新的槽位上，活跃连接在每次读写时的开销只是一次赋值
+*
+* 条目通过weak_ptr与其所属对象绑定（与Channel::tie相同），对象被销毁后到期回调不会被执行
+* 除构造函数外的所有接口都只能在loop所在的线程中调用
+*/
+class TimingWheel : noncopyable
+{
+public:
+    using ExpireCallback = std::function<void()>;
+
+    struct Entry
+    {
+        Entry *prev;
+        Entry *next;
+        int64_t deadline;           // 到期的tick
+        int64_t timeoutTicks;       // 超时时长，单位为tick
+        bool linked;                // 是否挂在某个槽位上
+        std::weak_ptr<void> tie;    // 所属对象
+        ExpireCallback callback;    // 到期回调
+    };
+
+    // tickSeconds为时间轮的精度，numBuckets为槽位数，必须为2的幂
+    TimingWheel(EventLoop *loop, double tickSeconds = 1.0, size_t numBuckets = 64);
+    ~TimingWheel();
+
+    // 添加一个超时条目，返回的指针在remove之前一直有效
+    Entry *add(const std::shared_ptr<void> &tie, double timeout, ExpireCallback cb);
+    // 对象有活动时调用，将到期时间推迟到当前时刻 + timeout
+    void refresh(Entry *entry)
+    {
+        entry->deadline = currentTick_ + entry->timeoutTicks;
+        if (!entry->linked) link(entry);
+    }
+    // 删除条目并释放其内存
+    void remove(Entry *entry);
+
+    size_t size() const { return size_; }
+
+private:
+    // 每个tick调用一次，扫描当前槽位
+    void onTick();
+    void link(Entry *entry);
+    void unlink(Entry *entry);
+
+private:
+    EventLoop *loop_;
+    const double tickSeconds_;
+    const size_t mask_;
+    std::vector<Entry> buckets_;    // 每个槽位是一个带哨兵的循环链表
+    int64_t currentTick_;
+    size_t size_;                   // 条目总数
+    size_t linkedCount_;            // 挂在槽位上的条目数
+    bool ticking_;                  // tick定时器是否在运行，时间轮为空时停止以避免空转唤醒
+    TimerId tickTimer_;
+};
@@ -0,0 +1,81 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "noncopyable.hpp"
+
+/*
+* 每个EventLoop一个的二进制事件跟踪环，代替热路径上的Info日志
+* 只由loop线程写入，每条记录是定长的二进制数据（操作、fd、事件、单调时钟纳秒），写入不格式化、不加锁、不分配内存
+* 环满后覆盖最旧的记录，可以在任意线程中读取快照，也可以在进程崩溃时由信号处理函数输出
+* 跟踪默认关闭，关闭时record只有一次relaxed原子读；可以通过setEnabled或环境变量MUDUO_TRACE=1开启
+*/
+class TraceRing : noncopyable
+{
+public:
+    enum Op : uint8_t
+    {
+        kEvent,     // Channel处理poll返回的事件，events为revents
+        kAdd,       // EPOLL_CTL_ADD
+        kMod,       // EPOLL_CTL_MOD
+        kDel,       // EPOLL_CTL_DEL
+        kUpdate,    // 其他Poller更新Channel关注的事件
+        kRemove,    // 从Poller中删除Channel
+    };
+
+    // 快照中的一条记录
+    struct Record
+    {
+        int64_t nanoseconds;    // Timestamp::monotonic()
+        int fd;
+        uint32_t events;
+        Op op;
+    };
+
+    static const size_t kCapacity = 4096; // 必须是2的幂
+
+    TraceRing();
+    ~TraceRing();
+
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+    static void setEnabled(bool on) { enabled_.store(on, std::memory_order_relaxed); }
+
+    // 只能在loop线程中调用
+    void record(Op op, int fd, uint32_t events)
+    {
+        if (enabled()) append(op, fd, events);
+    }
+
+    // 按时间顺序返回环中仍然有效的记录，可以在任意线程中调用
+    std::vector<Record> snapshot() const;
+    // 以文本形式把环中的记录写入fd，只使用异步信号安全的函数
+    void dump(int fd) const;
+
+    // 把所有存活的跟踪环写入fd
+    static void dumpAll(int fd);
+    // 在SIGSEGV、SIGBUS、SIGFPE、SIGILL、SIGABRT时先把所有跟踪环写入fd，再按默认方式结束进程
+    static void installCrashHandler(int fd = 2);
+
+    static const char *opName(Op op);
+
+private:
+    // 记录的各字段使用relaxed原子变量，读者与写者并发时不会产生数据竞争，只可能读到被覆盖的记录，由序号校验丢弃
+    struct Slot
+    {
+        std::atomic<int64_t> nanoseconds{0};
+        std::atomic<uint64_t> fdAndEvents{0};   // 高32位为fd，低32位为events
+        std::atomic<uint8_t> op{0};
+    };
+
+    void append(Op op, int fd, uint32_t events);
+    // 读取第seq条记录，写者可能已经覆盖该位置时返回false
+    bool read(uint64_t seq, Record *record) const;
+
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<uint64_t> next_;    // 下一条记录的序号，只由loop线程递增
+    int registryIndex_;             // 在全局登记表中的位置，登记表已满时为-1
+
+    static std::atomic<bool> enabled_;
+};
@@ -1,9 +1,11 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <cerrno>
+#include <fcntl.h>
 #include <unistd.h>
 #include "Acceptor.hpp"
 #include "InetAddress.hpp"
+#include "Metrics.hpp"
 #include "MyLog.hpp"
 
 // 创建一个非阻塞的socket
@@ -16,44 +18,140 @@ static int createNonblocking()
 }
 
 Acceptor::Acceptor(EventLoop* loop, const InetAddress &listenAddr, bool reuseport)
-    : loop_(loop), acceptSocket_(createNonblocking()), acceptChannel_(loop, acceptSocket_.fd()), listenning_(false)
+    : loop_(loop),
+      acceptSocket_(std::make_shared<Socket>(createNonblocking())),
+      acceptChannel_(loop, acceptSocket_->fd()),
+      listenning_(false),
+      acceptBatch_(kDefaultAcceptBatch),
+      idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC)),
+      acceptPaused_(false),
+      stats_(std::make_shared<Stats>())
+{
+    acceptSocket_->setReuseAddr(true);
+    acceptSocket_->setReusePort(reuseport);
+    acceptSocket_->bindAddress(listenAddr);
+    acceptChannel_.setReadCallback(std::bind(&Acceptor::handleRead, this));
+}
+
+Acceptor::Acceptor(EventLoop* loop, const std::shared_ptr<Socket> &listenSocket)
+    : loop_(loop),
+      acceptSocket_(listenSocket),
+      acceptChannel_(loop, acceptSocket_->fd()),
+      listenning_(false),
+      acceptBatch_(kDefaultAcceptBatch),
+      idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC)),
+      acceptPaused_(false),
+      stats_(std::make_shared<Stats>())
 {
-    acceptSocket_.setReuseAddr(true);
-    acceptSocket_.setReusePort(true);
-    acceptSocket_.bindAddress(listenAddr);
     acceptChannel_.setReadCallback(std::bind(&Acceptor::handleRead, this));
 }
 
 Acceptor::~Acceptor()
 {
+    // Acceptor在所属的loop中销毁，取消定时器会立即生效
+    if (acceptPaused_) loop_->cancel(resumeTimer_);
     acceptChannel_.disbaleAll();
     acceptChannel_.remove();
+    ::close(idleFd_);
 }
 
 void Acceptor::listen()
 {
     listenning_ = true;
-    acceptSocket_.Listen();
+    acceptSocket_->Listen(); // 共享的监听socket重复listen没有影响
     acceptChannel_.enableReading(); // 将监听socket注册到epoll中
 }
 
+// 循环accept直到没有新连接或达到acceptBatch_，再把这一批连接一次性交给上层
 void Acceptor::handleRead()
 {
-    InetAddress peerAddr;
-    int connfd = acceptSocket_.Accept(&peerAddr);
-    if (connfd >= 0)
+    accepted_.clear();
+    int shed = 0;
+    for (int i = 0; i < acceptBatch_; ++i)
     {
-        if (NewConnectionCallback_)
+        InetAddress peerAddr;
+        int connfd = acceptSocket_->Accept(&peerAddr);
+        if (connfd >= 0)
         {
-            NewConnectionCallback_(connfd, peerAddr);
+            accepted_.push_back({connfd, peerAddr});
+            continue;
         }
-        else // 没有处理连接的回调函数，直接关闭新链接
+
+        int savedErrno = errno;
+        // 没有更多连接；多个loop监听同一个socket时，连接也可能已经被其他loop取走
+        if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK) break;
+        // 连接在accept之前已被对端重置，继续处理下一个
+        if (savedErrno == ECONNABORTED || savedErrno == EINTR) continue;
+        if (savedErrno == EMFILE || savedErrno == ENFILE)
         {
-            close(connfd);
+            if (!shedConnection()) break;
+            ++shed;
+            continue;
         }
+        metricAdd(stats_->errors);
+        mylog::GetLogger("asynclogger")->Error("accept error: %s", strerror(savedErrno));
+        break;
+    }
+
+    metricAdd(stats_->batches);
+    metricAdd(stats_->accepted, accepted_.size());
+    if (shed > 0)
+    {
+        metricAdd(stats_->shed, shed);
+        mylog::GetLogger("asynclogger")->Error("accept: too many open files, %d connections dropped", shed);
+    }
+    if (accepted_.empty()) return;
+
+    if (newConnectionBatchCallback_)
+    {
+        newConnectionBatchCallback_(accepted_);
     }
     else
     {
-        mylog::GetLogger("asynclogger")->Error("accept error: %s", strerror(errno));
+        for (const AcceptedConnection &accepted : accepted_)
+        {
+            if (NewConnectionCallback_)
+            {
+                NewConnectionCallback_(accepted.sockfd, accepted.peerAddr);
+            }
+            else // 没有处理连接的回调函数，直接关闭新链接
+            {
+                ::close(accepted.sockfd);
+            }
+        }
     }
-}
\ No newline at end of file
+}
+
+bool Acceptor::shedConnection()
+{
+    if (idleFd_ < 0)
+    {
+        idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+        if (idleFd_ < 0)
+        {
+            // 无法丢弃等待中的连接，水平触发的监听socket会立即再次可读
+            pauseAccept();
+            return false;
+        }
+    }
+    ::close(idleFd_);
+    int connfd = ::accept(acceptSocket_->fd(), nullptr, nullptr);
+    if (connfd >= 0) ::close(connfd);
+    idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    return connfd >= 0;
+}
+
+void Acceptor::pauseAccept()
+{
+    if (acceptPaused_) return;
+    acceptPaused_ = true;
+    acceptChannel_.disableReading();
+    mylog::GetLogger("asynclogger")->Warn("accept: no reserve fd, pausing accept for %.1fs", kAcceptPauseSeconds);
+    resumeTimer_ = loop_->runAfter(kAcceptPauseSeconds, std::bind(&Acceptor::resumeAccept, this));
+}
+
+void Acceptor::resumeAccept()
+{
+    acceptPaused_ = false;
+    acceptChannel_.enableReading();
+}
@@ -1,14 +1,108 @@
 #include <cerrno>
 #include <sys/uio.h>
 #include <unistd.h>
+#include <cstdlib>
+#include <cstring>
 #include "Buffer.hpp"
+#include "MyLog.hpp"
+
+char Buffer::emptyStorage_[Buffer::CHEAP_PREPEND];
+
+Buffer::Buffer(const Buffer &rhs)
+    : Buffer(rhs.initialSize_, rhs.pool_)
+{
+    append(rhs.peek(), rhs.readableBytes());
+}
+
+void Buffer::makeSpace(size_t len)
+{
+    size_t readable = readableBytes();
+    // 可覆盖空间 + 剩余可写空间 < 所需空间
+    if (writableBytes() + prependableBytes() < len + CHEAP_PREPEND)
+    {
+        // 按倍数扩容，避免连续追加时反复拷贝
+        size_t size = std::max(CHEAP_PREPEND + readable + len, capacity_ * 2);
+        if (buffer_ == nullptr)
+        {
+            size = std::max(size, CHEAP_PREPEND + initialSize_);
+        }
+        reallocate(size);
+    }
+    else // 可覆盖空间 + 剩余可写空间 >= 所需空间
+    {
+        // 把可读数据移动到起始位置，空出来的空间即可写入数据
+        // 这么做的原因是，如果重新分配内存，反正也是要把数据拷到新分配的内存区域，代价只会更大
+        memmove(begin() + CHEAP_PREPEND, begin() + readerIndex_, readable);
+        readerIndex_ = CHEAP_PREPEND;
+        writerIndex_ = readerIndex_ + readable;
+    }
+}
+
+void Buffer::reallocate(size_t size)
+{
+    size_t capacity = 0;
+    char *storage = nullptr;
+    bool pooled = false;
+    if (pool_)
+    {
+        storage = pool_->allocate(size, &capacity);
+        pooled = (storage != nullptr);
+    }
+    if (storage == nullptr)
+    {
+        storage = static_cast<char*>(malloc(size));
+        capacity = size;
+        if (storage == nullptr)
+        {
+            mylog::GetLogger("asynclogger")->Fatal("Buffer malloc %lu bytes failed", size);
+        }
+    }
+
+    // 只拷贝可读数据，已读取的部分不需要保留
+    size_t readable = readableBytes();
+    memcpy(storage + CHEAP_PREPEND, peek(), readable);
+    releaseStorage();
+    buffer_ = storage;
+    capacity_ = capacity;
+    pooled_ = pooled;
+    readerIndex_ = CHEAP_PREPEND;
+    writerIndex_ = readerIndex_ + readable;
+}
+
+void Buffer::releaseStorage()
+{
+    if (buffer_ == nullptr) return;
+    if (pooled_)
+    {
+        pool_->deallocate(buffer_, capacity_);
+    }
+    else
+    {
+        free(buffer_);
+    }
+    buffer_ = nullptr;
+    capacity_ = 0;
+    pooled_ = false;
+}
+
+// 没有所属loop时使用的线程局部溢出区，只在线程启动时初始化一次，读取前不需要清零
+static thread_local char t_extrabuf[65536];
 
 ssize_t Buffer::readFd(int fd, int *saveErrno)
 {
-    // 额外栈空间，当从套接字读取的数据超过buffer_当前大小时，先将数据暂存
+    return readFd(fd, saveErrno, 0, t_extrabuf, sizeof(t_extrabuf));
+}
+
+ssize_t Buffer::readFd(int fd, int *saveErrno, size_t hint, char *extrabuf, size_t extrasize,
+                       size_t *capacity)
+{
+    // 预期的数据量直接读入buffer_，超出的部分先暂存在溢出区中
     // 待buffer_重新分配足够的空间后，在把数据添加到buffer_中
-    // 这么做利用了临时栈上空间，避免开巨大Buffer造成的内存浪费，也避免反复调用 read() 的系统开销
-    char extrabuf[65536] = {0}; // 64KB
+    // 溢出区由同一线程的所有连接共享，避免为偶尔出现的大数据常驻大Buffer，也避免反复调用 read() 的系统开销
+    if (hint > 0)
+    {
+        ensureWritableBytes(hint);
+    }
 
     iovec vec[2];
     const size_t writable = writableBytes(); // 获取剩余可写空间大小
@@ -16,11 +110,15 @@ ssize_t Buffer::readFd(int fd, int *saveErrno)
     // 第一块缓冲区指向buffer_的可写空间
     vec[0].iov_base = beginWrite();
     vec[0].iov_len = writable;
-    // 第二块缓冲区指向额外栈空间
+    // 第二块缓冲区指向溢出区
     vec[1].iov_base = extrabuf;
-    vec[1].iov_len = sizeof(extrabuf);
+    vec[1].iov_len = extrasize;
 
-    const int iovcnt = (writable < sizeof(extrabuf)) ? 2 : 1;
+    const int iovcnt = (writable < extrasize) ? 2 : 1;
+    if (capacity)
+    {
+        *capacity = (iovcnt == 2) ? writable + extrasize : writable;
+    }
     const ssize_t n = readv(fd, vec, iovcnt);
 
     if (n < 0)
@@ -33,8 +131,14 @@ ssize_t Buffer::readFd(int fd, int *saveErrno)
     }
     else
     {
-        writerIndex_ = buffer_.size();
-        append(extrabuf, n - writable); // 扩容并将额外栈区的数据追加到buffer中
+        writerIndex_ += writable;
+        append(extrabuf, n - writable); // 扩容并将溢出区的数据追加到buffer中
+    }
+
+    // 没有读到数据时，为hint预先分配的内存立即归还
+    if (readableBytes() == 0 && pool_)
+    {
+        retrieveAll();
     }
     return n;
 }
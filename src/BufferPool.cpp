@@ -0,0 +1,182 @@
+#include <sys/mman.h>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include "BufferPool.hpp"
+#include "CurrentThread.hpp"
+#include "MyLog.hpp"
+
+bool BufferPool::useHugePages_ = false;
+
+static bool hugePagesFromEnv()
+{
+    const char *env = getenv("TCPSERVER_HUGEPAGES");
+    return env != nullptr && strcmp(env, "0") != 0;
+}
+
+BufferPool::BufferPool()
+    : ownerTid_(CurrentThread::tid()),
+      hugePages_(useHugePages_ || hugePagesFromEnv()),
+      slabBytes_(0),
+      freeBytes_(0),
+      remoteFrees_(nullptr)
+{
+    for (int i = 0; i < kNumClasses; ++i)
+    {
+        classes_[i].chunkSize = kMinChunkSize << i;
+        classes_[i].carveCur = classes_[i].carveEnd = nullptr;
+    }
+}
+
+BufferPool::~BufferPool()
+{
+    for (auto &slab : slabs_)
+    {
+        munmap(slab.first, kSlabSize);
+    }
+}
+
+// 返回能容纳size字节的最小规格，超过最大规格返回-1
+int BufferPool::classIndex(size_t size)
+{
+    if (size > kMaxChunkSize) return -1;
+    int index = 0;
+    size_t chunk = kMinChunkSize;
+    while (chunk < size)
+    {
+        chunk <<= 1;
+        ++index;
+    }
+    return index;
+}
+
+bool BufferPool::inOwnerThread() const
+{
+    return ownerTid_ == CurrentThread::tid();
+}
+
+char *BufferPool::newSlab()
+{
+    void *addr = MAP_FAILED;
+    bool hugetlb = false;
+    if (hugePages_)
+    {
+        // 优先使用预留的大页，失败时退回普通映射并建议内核使用透明大页
+        addr = mmap(nullptr, kSlabSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        hugetlb = (addr != MAP_FAILED);
+    }
+    if (addr == MAP_FAILED)
+    {
+        addr = mmap(nullptr, kSlabSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (addr == MAP_FAILED)
+        {
+            mylog::GetLogger("asynclogger")->Error("BufferPool mmap error: %s", strerror(errno));
+            return nullptr;
+        }
+        if (hugePages_)
+        {
+            madvise(addr, kSlabSize, MADV_HUGEPAGE);
+        }
+    }
+    slabs_.emplace_back(static_cast<char*>(addr), hugetlb);
+    slabBytes_ += kSlabSize;
+    return static_cast<char*>(addr);
+}
+
+char *BufferPool::allocate(size_t size, size_t *actual)
+{
+    int index = classIndex(size);
+    // 大块内存以及其他线程的请求不由内存池处理
+    if (index < 0 || !inOwnerThread())
+    {
+        return nullptr;
+    }
+
+    SizeClass &sc = classes_[index];
+    if (sc.hot.empty() && sc.cold.empty())
+    {
+        drainRemoteFrees();
+    }
+
+    char *ptr = nullptr;
+    if (!sc.hot.empty())
+    {
+        ptr = sc.hot.back();
+        sc.hot.pop_back();
+        freeBytes_ -= sc.chunkSize;
+    }
+    else if (!sc.cold.empty())
+    {
+        ptr = sc.cold.back();
+        sc.cold.pop_back();
+        freeBytes_ -= sc.chunkSize;
+    }
+    else
+    {
+        if (sc.carveCur == sc.carveEnd)
+        {
+            char *slab = newSlab();
+            if (slab == nullptr) return nullptr;
+            sc.carveCur = slab;
+            sc.carveEnd = slab + kSlabSize;
+        }
+        ptr = sc.carveCur;
+        sc.carveCur += sc.chunkSize;
+    }
+    *actual = sc.chunkSize;
+    return ptr;
+}
+
+void BufferPool::deallocate(char *ptr, size_t capacity)
+{
+    if (inOwnerThread())
+    {
+        deallocateLocal(ptr, classIndex(capacity));
+    }
+    else
+    {
+        // 压入远端释放栈，等待所属线程回收
+        RemoteNode *node = reinterpret_cast<RemoteNode*>(ptr);
+        node->capacity = capacity;
+        node->next = remoteFrees_.load(std::memory_order_relaxed);
+        while (!remoteFrees_.compare_exchange_weak(node->next, node,
+                                                   std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+    }
+}
+
+void BufferPool::deallocateLocal(char *ptr, int index)
+{
+    SizeClass &sc = classes_[index];
+    sc.hot.push_back(ptr);
+    freeBytes_ += sc.chunkSize;
+}
+
+void BufferPool::drainRemoteFrees()
+{
+    RemoteNode *node = remoteFrees_.exchange(nullptr, std::memory_order_acquire);
+    while (node != nullptr)
+    {
+        RemoteNode *next = node->next;
+        deallocateLocal(reinterpret_cast<char*>(node), classIndex(node->capacity));
+        node = next;
+    }
+}
+
+void BufferPool::trim()
+{
+    drainRemoteFrees();
+    for (SizeClass &sc : classes_)
+    {
+        size_t retain = std::max<size_t>(1, kRetainBytesPerClass / sc.chunkSize);
+        while (sc.hot.size() > retain)
+        {
+            char *ptr = sc.hot.back();
+            sc.hot.pop_back();
+            // MAP_HUGETLB映射的大页不能部分归还，madvise会失败，块仍然可以复用
+            madvise(ptr, sc.chunkSize, MADV_DONTNEED);
+            sc.cold.push_back(ptr);
+        }
+    }
+}
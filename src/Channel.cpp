@@ -6,9 +6,13 @@
 const int Channel::noneEvent = 0;                  // 无事件
 const int Channel::readEvent = EPOLLIN | EPOLLPRI; // 读事件和紧急数据
 const int Channel::writeEvent = EPOLLOUT;          // 写事件
+const int Channel::edgeEvent = EPOLLET;            // 边沿触发
+const int Channel::urgentEvent = EPOLLPRI;         // 紧急数据
+const int Channel::exclusiveEvent = EPOLLEXCLUSIVE; // 独占唤醒
 
 Channel::Channel(EventLoop* loop, int fd)
-    : loop_(loop), fd_(fd), events_(0), revents_(0), index_(-1), tied_(false) {}
+    : loop_(loop), fd_(fd), events_(0), revents_(0), index_(-1),
+      edgeTriggered_(false), exclusive_(false), registeredEvents_(0), tied_(false) {}
 
 // 用于确保Channel的能在正确的时间销毁
 void Channel::tie(const std::shared_ptr<void> &obj)
@@ -20,12 +24,14 @@ void Channel::tie(const std::shared_ptr<void> &obj)
 // 更新epollfd中Channel对应的事件
 void Channel::update()
 {
+    registeredEvents_ = pollEvents();
     loop_->updateChannel(this);
 }
 
 // 在Channel所属的EvenLoop中把当前的Channel删除
 void Channel::remove()
 {
+    registeredEvents_ = noneEvent;
     loop_->removeChannel(this);
 }
 
@@ -47,7 +53,7 @@ void Channel::handleEvent(Timestamp receiveTime)
 
 void Channel::handleEventWithGuard(Timestamp receiveTime)
 {
-    mylog::GetLogger("asynclogger")->Info("channel handleEvent revents:%d\n", revents_);
+    loop_->traceRing().record(TraceRing::kEvent, fd_, static_cast<uint32_t>(revents_));
 
     // 关闭事件, 当通过shutdown关闭Channel的写端时触发
     if ((revents_ & EPOLLHUP) && !(revents_ & EPOLLIN))
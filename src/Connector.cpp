@@ -0,0 +1,247 @@
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "Connector.hpp"
+#include "Channel.hpp"
+#include "EventLoop.hpp"
+#include "MyLog.hpp"
+
+namespace
+{
+int createNonblockingOrDie()
+{
+    int sockfd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+    if (sockfd < 0)
+        mylog::GetLogger("asynclogger")->Fatal("Connector socket error: %s", strerror(errno));
+    return sockfd;
+}
+
+int getSocketError(int sockfd)
+{
+    int optval = 0;
+    socklen_t optlen = sizeof(optval);
+    if (::getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &optval, &optlen) < 0) return errno;
+    return optval;
+}
+
+// 连接本机上未监听的端口时，内核可能把临时端口分配成目标端口，形成自连接
+bool isSelfConnect(int sockfd)
+{
+    sockaddr_in local, peer;
+    socklen_t len = sizeof(local);
+    ::memset(&local, 0, sizeof(local));
+    ::memset(&peer, 0, sizeof(peer));
+    if (::getsockname(sockfd, (sockaddr*)&local, &len) < 0) return false;
+    len = sizeof(peer);
+    if (::getpeername(sockfd, (sockaddr*)&peer, &len) < 0) return false;
+    return local.sin_port == peer.sin_port && local.sin_addr.s_addr == peer.sin_addr.s_addr;
+}
+}
+
+Connector::Connector(EventLoop *loop, const InetAddress &serverAddr)
+    : loop_(loop),
+      serverAddr_(serverAddr),
+      connect_(false),
+      state_(kDisconnected),
+      initRetryDelay_(kDefaultInitRetryDelay),
+      maxRetryDelay_(kDefaultMaxRetryDelay),
+      retryDelay_(kDefaultInitRetryDelay),
+      connectedAt_(),
+      retryPending_(false),
+      random_(std::random_device()())
+{
+}
+
+Connector::~Connector()
+{
+}
+
+void Connector::setRetryDelay(double initial, double max)
+{
+    initRetryDelay_ = initial > 0.0 ? initial : kDefaultInitRetryDelay;
+    maxRetryDelay_ = std::max(max, initRetryDelay_);
+    retryDelay_ = initRetryDelay_;
+}
+
+void Connector::start()
+{
+    connect_ = true;
+    loop_->runInLoop(std::bind(&Connector::startInLoop, shared_from_this()));
+}
+
+void Connector::startInLoop()
+{
+    if (!connect_ || state_ != kDisconnected || retryPending_) return;
+    connect();
+}
+
+void Connector::restart()
+{
+    setState(kDisconnected);
+    connect_ = true;
+    // 只有连接稳定保持了一段时间才重置退避，对端接受后立即关闭时延迟继续增长，不会变成零间隔的重连循环
+    if (Duration::seconds(kMinStableTime) < Timestamp::monotonic() - connectedAt_)
+    {
+        retryDelay_ = initRetryDelay_;
+    }
+    if (!retryPending_) scheduleRetry();
+}
+
+void Connector::stop()
+{
+    connect_ = false;
+    loop_->runInLoop(std::bind(&Connector::stopInLoop, shared_from_this()));
+}
+
+void Connector::stopInLoop()
+{
+    if (retryPending_)
+    {
+        loop_->cancel(retryTimer_);
+        retryPending_ = false;
+    }
+    if (state_ == kConnecting)
+    {
+        setState(kDisconnected);
+        ::close(removeAndResetChannel());
+    }
+}
+
+void Connector::connect()
+{
+    int sockfd = createNonblockingOrDie();
+    int ret = ::connect(sockfd, (sockaddr*)serverAddr_.getSockAddr(), sizeof(sockaddr_in));
+    int savedErrno = (ret == 0) ? 0 : errno;
+    switch (savedErrno)
+    {
+    case 0:
+    case EINPROGRESS:
+    case EINTR:
+    case EISCONN:
+        connecting(sockfd);
+        break;
+
+    // 暂时性的失败，退避后重试
+    case EAGAIN:
+    case EADDRINUSE:
+    case EADDRNOTAVAIL:
+    case ECONNREFUSED:
+    case ENETUNREACH:
+    case EHOSTUNREACH:
+    case ETIMEDOUT:
+        retry(sockfd);
+        break;
+
+    // 地址或参数错误，重试也不会成功
+    default:
+        mylog::GetLogger("asynclogger")->Error("Connector::connect %s error: %s",
+                serverAddr_.toIpPort().c_str(), strerror(savedErrno));
+        ::close(sockfd);
+        connect_ = false;
+        break;
+    }
+}
+
+void Connector::connecting(int sockfd)
+{
+    setState(kConnecting);
+    channel_.reset(new Channel(loop_, sockfd));
+    channel_->setWriteCallback(std::bind(&Connector::handleWrite, this));
+    channel_->setErrorCallback(std::bind(&Connector::handleError, this));
+    channel_->enableWriting();
+}
+
+int Connector::removeAndResetChannel()
+{
+    channel_->disbaleAll();
+    channel_->remove();
+    int sockfd = channel_->fd();
+    // 可能正处于channel_的事件处理中，放到本轮事件处理之后再销毁
+    loop_->queueInLoop(std::bind(&Connector::resetChannel, shared_from_this()));
+    return sockfd;
+}
+
+void Connector::resetChannel()
+{
+    channel_.reset();
+}
+
+void Connector::handleWrite()
+{
+    // 连接失败时错误事件和可写事件一起返回，handleError已经处理过
+    if (state_ != kConnecting) return;
+
+    int sockfd = removeAndResetChannel();
+    int err = getSocketError(sockfd);
+    if (err != 0)
+    {
+        mylog::GetLogger("asynclogger")->Info("Connector::handleWrite %s - SO_ERROR: %s",
+                serverAddr_.toIpPort().c_str(), strerror(err));
+        retry(sockfd);
+    }
+    else if (isSelfConnect(sockfd))
+    {
+        mylog::GetLogger("asynclogger")->Info("Connector::handleWrite %s - self connect", serverAddr_.toIpPort().c_str());
+        retry(sockfd);
+    }
+    else
+    {
+        setState(kConnected);
+        connectedAt_ = Timestamp::monotonic();
+        if (connect_ && newConnectionCallback_)
+        {
+            newConnectionCallback_(sockfd);
+        }
+        else
+        {
+            ::close(sockfd);
+        }
+    }
+}
+
+void Connector::handleError()
+{
+    if (state_ != kConnecting) return;
+
+    int sockfd = removeAndResetChannel();
+    int err = getSocketError(sockfd);
+    mylog::GetLogger("asynclogger")->Info("Connector::handleError %s - SO_ERROR: %s",
+            serverAddr_.toIpPort().c_str(), strerror(err));
+    retry(sockfd);
+}
+
+void Connector::retry(int sockfd)
+{
+    ::close(sockfd);
+    setState(kDisconnected);
+    scheduleRetry();
+}
+
+void Connector::scheduleRetry()
+{
+    if (!connect_) return;
+
+    double delay = nextRetryDelay();
+    mylog::GetLogger("asynclogger")->Info("Connector::retry - retry connecting to %s in %.3f seconds",
+            serverAddr_.toIpPort().c_str(), delay);
+    std::weak_ptr<Connector> weakSelf(shared_from_this());
+    retryPending_ = true;
+    retryTimer_ = loop_->runAfter(delay, [weakSelf]
+    {
+        ConnectorPtr self(weakSelf.lock());
+        if (!self) return;
+        self->retryPending_ = false;
+        self->startInLoop();
+    });
+}
+
+double Connector::nextRetryDelay()
+{
+    // 在[d/2, d]之间随机，既保留退避的下限，又打散同时失败的客户端
+    std::uniform_real_distribution<double> jitter(0.5, 1.0);
+    double delay = retryDelay_ * jitter(random_);
+    retryDelay_ = std::min(retryDelay_ * 2, maxRetryDelay_);
+    return delay;
+}
@@ -1,12 +1,22 @@
 #include <cstdlib>
 #include "Poller.hpp"
 #include "EpollPoller.hpp"
+#include "PollPoller.hpp"
+#include "IoUringPoller.hpp"
+#include "MyLog.hpp"
 
 Poller* Poller::newDefaultPoller(EventLoop* loop)
 {
     // 获取环境变量名对应的值
-    if (getenv("MUDUO_USE_POLL"))
-        return nullptr;
+    if (getenv("MUDUO_USE_URING"))
+    {
+        if (IoUringPoller::isSupported())
+            return new IoUringPoller(loop);
+        mylog::GetLogger("asynclogger")->Error("io_uring is not supported, fall back to epoll");
+        return new EpollPoller(loop);
+    }
+    else if (getenv("MUDUO_USE_POLL"))
+        return new PollPoller(loop);
     else
         return new EpollPoller(loop);
-}
\ No newline at end of file
+}
@@ -62,9 +62,7 @@ Timestamp EpollPoller::poll(int timeoutMs, ChannelList* activeChannels)
 void EpollPoller::updateChannel(Channel* channel)
 {
     const int index = channel->index();
-    mylog::GetLogger("asynclogger")->Info(
-        "func: %s => fd: %d event: %d index: %d", __FUNCTION__, channel->fd(), channel->events(),index);
-    
+
     if (index == NEW || index == DELETED)
     {
         // 将未加入的Channel加入Poller的Channel列表中
@@ -92,7 +90,7 @@ void EpollPoller::removeChannel(Channel* channel)
 {
     int fd = channel->fd();
     channels_.erase(fd);
-    mylog::GetLogger("asynclogger")->Info("func: %s => fd: %d", __FUNCTION__, fd);
+    traceRing().record(TraceRing::kRemove, fd, 0);
 
     if (ADDED == channel->index()) update(EPOLL_CTL_DEL, channel);
     channel->set_index(NEW);
@@ -115,9 +113,13 @@ void EpollPoller::update(int operation, Channel* channel)
     bzero(&event, sizeof(event));
 
     int fd = channel->fd();
-    event.events = channel->events();
+    event.events = channel->pollEvents();
     event.data.ptr = channel;
 
+    TraceRing::Op op = operation == EPOLL_CTL_ADD ? TraceRing::kAdd
+                     : operation == EPOLL_CTL_MOD ? TraceRing::kMod : TraceRing::kDel;
+    traceRing().record(op, fd, event.events);
+
     if (epoll_ctl(epollfd_, operation, fd, &event) < 0)
     {
         if (operation == EPOLL_CTL_DEL)
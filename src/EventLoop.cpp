@@ -6,6 +6,9 @@
 #include "EventLoop.hpp"
 #include "Channel.hpp"
 #include "Poller.hpp"
+#include "TimerQueue.hpp"
+#include "TimingWheel.hpp"
+#include "BufferPool.hpp"
 #include "MyLog.hpp"
 
 // 避免一个线程创建多个EventLoop实例
@@ -14,6 +17,9 @@ thread_local EventLoop *t_loopInThisThread = nullptr;
 // 定义默认的Poller IO复用接口的超时时间
 const int POLLTIMEMS = 10000; // 10s
 
+// Buffer内存池归还空闲内存的间隔
+const double BUFFERPOOL_TRIM_SECONDS = 10.0;
+
 // 创建eventfd用于唤醒subReactor处理新来的channel
 int createEventfd()
 {
@@ -29,8 +35,14 @@ EventLoop::EventLoop()
     : looping_(false),
       quit_(false), 
       callingPendingFuntors_(false), 
+      wakeupPending_(false),
       threadId_(CurrentThread::tid()),
+      cpu_(-1),
+      numaNode_(-1),
       poller_(Poller::newDefaultPoller(this)),
+      timerQueue_(new TimerQueue(this)),
+      bufferPool_(std::make_shared<BufferPool>()),
+      readOverflow_(new char[kReadOverflowSize]),
       wakeupFd_(createEventfd()),
       wakeupChannel_(new Channel(this, wakeupFd_))
 {
@@ -48,6 +60,8 @@ EventLoop::EventLoop()
 
     wakeupChannel_->setReadCallback(std::bind(&EventLoop::handleRead, this));
     wakeupChannel_->enableReading();
+
+    runEvery(BUFFERPOOL_TRIM_SECONDS, std::bind(&BufferPool::trim, bufferPool_.get()));
 }
 
 EventLoop::~EventLoop()
@@ -70,12 +84,16 @@ void EventLoop::loop()
     while (!quit_)
     {
         activecChannels_.clear(); // 清空活跃事件列表
-        pollReturnTime_ = poller_->poll(POLLTIMEMS, &activecChannels_); // 调用epoll_wait获取活跃事件
+        // 还有未执行的回调（超出预算或loop线程自己入队）时不阻塞
+        int timeoutMs = localFunctors_.empty() && pengdingFuntors_.empty() ? POLLTIMEMS : 0;
+        pollReturnTime_ = poller_->poll(timeoutMs, &activecChannels_); // 调用epoll_wait获取活跃事件
+        pollReturnMono_ = Timestamp::monotonic();
         for (auto channel : activecChannels_)
         {
             // 通知channel处理事件
             channel->handleEvent(pollReturnTime_);
         }
+        Duration handlersDone = activecChannels_.empty() ? pollReturnMono_ : Timestamp::monotonic();
         /**
          * 执行当前EventLoop事件循环需要处理的回调操作 对于线程数 >=2 的情况 IO线程 mainloop(mainReactor) 主要工作：
          * accept接收连接 => 将accept返回的connfd打包为Channel => TcpServer::newConnection通过轮询将TcpConnection对象分配给subloop处理
@@ -83,6 +101,7 @@ void EventLoop::loop()
          * mainloop调用queueInLoop将回调加入subloop（该回调需要subloop执行 但subloop还在poller_->poll处阻塞） queueInLoop通过wakeup将subloop唤醒
          **/
         doPendingFunctions();
+        recordIteration(handlersDone);
     }
     mylog::GetLogger("asynclogger")->Info("EventLoop %p stop looping", this);
     looping_ = false;
@@ -113,21 +132,26 @@ void EventLoop::runInLoop(Functor cb)
     else
     {
         // 与EventLoop实例不在同一线程，则需要唤醒该EventLoop所在线程执行cb
-        queueInLoop(cb);
+        queueInLoop(std::move(cb));
     }
 }
 
 // 把cb放入队列中，并唤醒loop所在的线程执行cb
 void EventLoop::queueInLoop(Functor cb)
 {
+    // loop线程自己入队时，loop在下一次阻塞前会检查队列，不需要唤醒
+    if (isInLoopThread())
     {
-        std::unique_lock<std::mutex> lock(mutex_);
-        pengdingFuntors_.emplace_back(cb);
+        localFunctors_.push_back(std::move(cb));
+        return;
     }
 
-    // 如果Loop所在的线程正在执行其他回调函数，此时为了避免执行完当前回调后再一次循环进入epoll_wait的阻塞等待状态，
-    // 导致回调函数无法及时执行，需要唤醒线程进入下一次循环后立即执行回调
-    if (!isInLoopThread() || callingPendingFuntors_)
+    // 其他线程入队时，只有loop清除wakeupPending_之后的第一个生产者需要写eventfd
+    loadStats_.pendingFunctors.fetch_add(1, std::memory_order_relaxed);
+    pengdingFuntors_.push(QueuedFunctor{std::move(cb), Timestamp::monotonic()});
+    // 与doPendingFunctions中的fence配对：要么loop看到新入队的回调，要么这里看到wakeupPending_已被清除
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!wakeupPending_.exchange(true, std::memory_order_relaxed))
     {
         wakeup();
     }
@@ -151,6 +175,37 @@ void EventLoop::wakeup()
     }
 }
 
+TimerId EventLoop::runAt(Timestamp time, TimerCallback cb)
+{
+    return timerQueue_->addTimer(std::move(cb), time, 0.0);
+}
+
+TimerId EventLoop::runAfter(double delay, TimerCallback cb)
+{
+    Timestamp time(addTime(Timestamp::now(), delay));
+    return runAt(time, std::move(cb));
+}
+
+TimerId EventLoop::runEvery(double interval, TimerCallback cb)
+{
+    Timestamp time(addTime(Timestamp::now(), interval));
+    return timerQueue_->addTimer(std::move(cb), time, interval);
+}
+
+void EventLoop::cancel(TimerId timerId)
+{
+    timerQueue_->cancel(timerId);
+}
+
+TimingWheel *EventLoop::timingWheel()
+{
+    if (!timingWheel_)
+    {
+        timingWheel_.reset(new TimingWheel(this));
+    }
+    return timingWheel_.get();
+}
+
 void EventLoop::updateChannel(Channel* channel)
 {
     poller_->updateChannel(channel);
@@ -166,21 +221,62 @@ bool EventLoop::hasChannel(Channel* channel)
     return poller_->hasChannel(channel);
 }
 
-// 执行所有回调函数
+bool EventLoop::supportsEdgeTriggered() const
+{
+    return poller_->supportsEdgeTriggered();
+}
+
+// 执行队列中的回调函数
+// 先取出本轮要执行的回调再逐个执行，执行过程中新入队的回调留到下一轮，避免回调不断入队自身时占住loop
 void EventLoop::doPendingFunctions()
 {
-    std::vector<Functor> functors;
     callingPendingFuntors_ = true;
 
+    // 清除之后入队的生产者会重新唤醒loop
+    wakeupPending_.store(false, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    runningFunctors_.swap(localFunctors_);
+    QueuedFunctor queued;
+    uint32_t popped = 0;
+    Duration now;
+    bool haveNow = false;
+    while (runningFunctors_.size() < static_cast<size_t>(kPendingFunctorsBudget) &&
+           pengdingFuntors_.pop(queued))
     {
-        std::unique_lock<std::mutex> lock(mutex_);
-        functors.swap(pengdingFuntors_);
+        if (!haveNow)
+        {
+            now = Timestamp::monotonic();
+            haveNow = true;
+        }
+        loopStats_.queueLatency.record((now - queued.enqueueTime).microseconds());
+        runningFunctors_.push_back(std::move(queued.functor));
+        ++popped;
+    }
+    if (popped > 0)
+    {
+        loadStats_.pendingFunctors.fetch_sub(popped, std::memory_order_relaxed);
     }
 
-    for (const Functor &functor : functors)
+    for (Functor &f : runningFunctors_)
     {
-        functor();
+        f();
     }
+    metricAdd(loopStats_.functors, runningFunctors_.size());
+    runningFunctors_.clear();
 
     callingPendingFuntors_ = false;
-}
\ No newline at end of file
+}
+// 用本轮从poll返回到回调执行完的耗时更新滑动平均，新样本占1/8
+void EventLoop::recordIteration(Duration handlersDone)
+{
+    int64_t busy = (Timestamp::monotonic() - pollReturnMono_).microseconds();
+    if (busy < 0) busy = 0;
+    metricAdd(loopStats_.iterations);
+    metricAdd(loopStats_.events, activecChannels_.size());
+    loopStats_.iterationTime.record(busy);
+    loopStats_.handlerTime.record((handlersDone - pollReturnMono_).microseconds());
+    int64_t avg = static_cast<int64_t>(loadStats_.iterationUs.load(std::memory_order_relaxed));
+    avg += (busy - avg) / 8;
+    loadStats_.iterationUs.store(static_cast<uint64_t>(avg), std::memory_order_relaxed);
+}
@@ -1,5 +1,12 @@
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/mempolicy.h>
+#include <cerrno>
+#include <string.h>
 #include "EventLoopThread.hpp"
 #include "EventLoop.hpp"
+#include "MyLog.hpp"
 
 EventLoopThread::EventLoopThread(const ThreadInitCallback &cb, const std::string &name)
     : loop_(nullptr), 
@@ -7,7 +14,8 @@ EventLoopThread::EventLoopThread(const ThreadInitCallback &cb, const std::string
       thread_(std::bind(&EventLoopThread::threadFunc, this), name),
       mutex_(),
       cond_(),
-      callback_(cb)
+      callback_(cb),
+      numaLocal_(false)
 {
 }
 
@@ -21,6 +29,12 @@ EventLoopThread::~EventLoopThread()
     }
 }
 
+void EventLoopThread::setPlacement(const std::vector<int> &cpus, bool numaLocal)
+{
+    cpus_ = cpus;
+    numaLocal_ = numaLocal;
+}
+
 // 创建线程并通过线程函数绑定一个新的EventLoop
 EventLoop *EventLoopThread::startLoop()
 {
@@ -37,7 +51,12 @@ EventLoop *EventLoopThread::startLoop()
 
 void EventLoopThread::threadFunc()
 {
+    int cpu = -1;
+    int node = -1;
+    applyPlacement(&cpu, &node);
+
     EventLoop loop; // 创建一个EventLoop
+    loop.setPlacement(cpu, node);
 
     // 调用线程初始化回调函数
     if (callback_)
@@ -53,4 +72,44 @@ void EventLoopThread::threadFunc()
     loop.loop(); // 启动loop的事件循环
     std::unique_lock<std::mutex> lock(mutex_);
     loop_ = nullptr;
-}
\ No newline at end of file
+}
+void EventLoopThread::applyPlacement(int *cpu, int *node)
+{
+    if (cpus_.empty() && !numaLocal_) return;
+
+    if (!cpus_.empty())
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int c : cpus_)
+        {
+            if (c >= 0 && c < CPU_SETSIZE) CPU_SET(c, &set);
+        }
+        // 设置后内核立即把线程迁移到允许的cpu上
+        if (sched_setaffinity(0, sizeof(set), &set) < 0)
+        {
+            mylog::GetLogger("asynclogger")->Error("sched_setaffinity error: %s", strerror(errno));
+            return;
+        }
+    }
+
+    unsigned currentCpu = 0;
+    unsigned currentNode = 0;
+    if (syscall(SYS_getcpu, &currentCpu, &currentNode, nullptr) < 0) return;
+    if (cpus_.size() == 1) *cpu = static_cast<int>(currentCpu);
+
+    if (numaLocal_)
+    {
+        // 使用MPOL_PREFERRED而不是MPOL_BIND：本地节点内存不足时退回其他节点，而不是让loop线程因OOM被杀
+        unsigned long nodemask[16] = {};
+        const unsigned long bits = sizeof(nodemask[0]) * 8;
+        if (currentNode >= bits * 16) return;
+        nodemask[currentNode / bits] = 1UL << (currentNode % bits);
+        if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, nodemask, bits * 16) < 0)
+        {
+            mylog::GetLogger("asynclogger")->Error("set_mempolicy error: %s", strerror(errno));
+            return;
+        }
+        *node = static_cast<int>(currentNode);
+    }
+}
@@ -1,10 +1,13 @@
 #include <memory>
+#include "EventLoop.hpp"
 #include "EventLoopThread.hpp"
 #include "EventLoopThreadPool.hpp"
+#include "InetAddress.hpp"
 #include "MyLog.hpp"
 
 EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseLoop, const std::string &nameArg)
-    : baseLoop_(baseLoop), name_(nameArg), started_(false), numThreads_(0), next_(0)
+    : baseLoop_(baseLoop), name_(nameArg), started_(false), numThreads_(0), next_(0),
+      policy_(kRoundRobin), seed_(2463534242u), numaLocal_(false)
 {
 }
 
@@ -19,6 +22,10 @@ void EventLoopThreadPool::start(const ThreadInitCallback &cb)
     {
         std::string name = name_ + std::to_string(i);
         threads_.push_back(std::make_unique<EventLoopThread>(cb, name));
+        if (!cpuSets_.empty() || numaLocal_)
+        {
+            threads_[i]->setPlacement(cpuSets_.empty() ? std::vector<int>() : cpuSets_[i % cpuSets_.size()], numaLocal_);
+        }
         loops_.push_back(threads_[i]->startLoop());
     }
 
@@ -31,17 +38,108 @@ void EventLoopThreadPool::start(const ThreadInitCallback &cb)
 
 EventLoop* EventLoopThreadPool::getNextLoop()
 {
-    EventLoop* loop = baseLoop_; // 如果只有baseLoop一个线程，那么Channel永远分配给baseLoop
+    return selectLoop(nullptr);
+}
+
+EventLoop* EventLoopThreadPool::getNextLoop(const InetAddress &peerAddr)
+{
+    return selectLoop(&peerAddr);
+}
+
+// 已建立的连接加上已分配但尚未在subloop中建立的连接，同一批accept中先分配的连接对后面的选择可见
+static uint64_t connectionLoad(EventLoop *loop)
+{
+    const EventLoop::LoadStats &stats = loop->loadStats();
+    return static_cast<uint64_t>(stats.connections.load(std::memory_order_relaxed)) +
+           stats.pendingConnections.load(std::memory_order_relaxed);
+}
 
-    if (!loops_.empty())
+EventLoop *EventLoopThreadPool::selectLoop(const InetAddress *peerAddr)
+{
+    // 如果只有baseLoop一个线程，那么Channel永远分配给baseLoop
+    if (loops_.empty()) return baseLoop_;
+    if (loops_.size() == 1) return loops_[0];
+
+    if (selector_)
     {
-        loop = loops_[next_++];
-        if (next_ >= loops_.size()) next_ = 0;
+        EventLoop *loop = selector_(loops_, peerAddr);
+        return loop != nullptr ? loop : roundRobin();
     }
 
+    switch (policy_)
+    {
+    case kLeastConnections:
+        return leastLoaded(connectionLoad);
+    case kLeastPending:
+        return leastLoaded([](EventLoop *loop) {
+            return static_cast<uint64_t>(loop->loadStats().pendingFunctors.load(std::memory_order_relaxed));
+        });
+    case kLowestLatency:
+        return leastLoaded([](EventLoop *loop) {
+            return loop->loadStats().iterationUs.load(std::memory_order_relaxed);
+        });
+    case kPowerOfTwoChoices:
+    {
+        size_t n = loops_.size();
+        size_t a = nextRandom() % n;
+        size_t b = nextRandom() % (n - 1);
+        if (b >= a) ++b;
+        EventLoop *first = loops_[a];
+        EventLoop *second = loops_[b];
+        return connectionLoad(second) < connectionLoad(first) ? second : first;
+    }
+    case kPeerHash:
+        if (peerAddr != nullptr)
+        {
+            // 只对ip哈希，同一客户端的多个连接落在同一个loop
+            uint32_t h = peerAddr->getSockAddr()->sin_addr.s_addr * 2654435761u;
+            return loops_[h % loops_.size()];
+        }
+        return roundRobin();
+    case kRoundRobin:
+    default:
+        return roundRobin();
+    }
+}
+
+EventLoop *EventLoopThreadPool::roundRobin()
+{
+    EventLoop *loop = loops_[next_++];
+    if (next_ >= static_cast<int>(loops_.size())) next_ = 0;
     return loop;
 }
 
+template <typename Load>
+EventLoop *EventLoopThreadPool::leastLoaded(Load load)
+{
+    size_t n = loops_.size();
+    size_t start = static_cast<size_t>(next_);
+    if (++next_ >= static_cast<int>(n)) next_ = 0;
+
+    EventLoop *best = loops_[start];
+    uint64_t bestLoad = load(best);
+    for (size_t i = 1; i < n && bestLoad > 0; ++i)
+    {
+        EventLoop *loop = loops_[(start + i) % n];
+        uint64_t l = load(loop);
+        if (l < bestLoad)
+        {
+            best = loop;
+            bestLoad = l;
+        }
+    }
+    return best;
+}
+
+// xorshift32
+uint32_t EventLoopThreadPool::nextRandom()
+{
+    seed_ ^= seed_ << 13;
+    seed_ ^= seed_ >> 17;
+    seed_ ^= seed_ << 5;
+    return seed_;
+}
+
 std::vector<EventLoop*> EventLoopThreadPool::getAllLoops()
 {
     if (loops_.empty()) return {baseLoop_};
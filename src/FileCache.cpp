@@ -0,0 +1,172 @@
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include "FileCache.hpp"
+
+CachedFile::~CachedFile()
+{
+    ::close(fd_);
+}
+
+FileCache::FileCache(size_t maxOpenFiles, double revalidateInterval)
+    : maxOpenFiles_(maxOpenFiles > 0 ? maxOpenFiles : 1),
+      revalidateInterval_(Duration::seconds(revalidateInterval)),
+      hits_(0),
+      misses_(0)
+{
+}
+
+CachedFilePtr FileCache::openFile(const std::string &path, int *savedErrno)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        *savedErrno = errno;
+        return nullptr;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) < 0)
+    {
+        *savedErrno = errno;
+        ::close(fd);
+        return nullptr;
+    }
+    if (!S_ISREG(st.st_mode))
+    {
+        *savedErrno = S_ISDIR(st.st_mode) ? EISDIR : EACCES;
+        ::close(fd);
+        return nullptr;
+    }
+    return std::make_shared<const CachedFile>(fd, st);
+}
+
+bool FileCache::sameFile(const struct stat &a, const struct stat &b)
+{
+    return a.st_dev == b.st_dev && a.st_ino == b.st_ino && a.st_size == b.st_size &&
+           a.st_mtim.tv_sec == b.st_mtim.tv_sec && a.st_mtim.tv_nsec == b.st_mtim.tv_nsec;
+}
+
+CachedFilePtr FileCache::open(const std::string &path, int *savedErrno)
+{
+    Duration now = Timestamp::monotonic();
+    CachedFilePtr stale;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(path);
+        if (it != entries_.end())
+        {
+            lru_.splice(lru_.begin(), lru_, it->second.lruPos);
+            if (now - it->second.validatedAt < revalidateInterval_)
+            {
+                ++hits_;
+                return it->second.file;
+            }
+            stale = it->second.file;
+        }
+    }
+
+    if (stale)
+    {
+        // 文件没有变化时只需要一次stat
+        struct stat st;
+        if (::stat(path.c_str(), &st) == 0 && sameFile(st, stale->stat()))
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = entries_.find(path);
+            if (it != entries_.end() && it->second.file == stale)
+            {
+                it->second.validatedAt = now;
+            }
+            ++hits_;
+            return stale;
+        }
+    }
+
+    std::vector<CachedFilePtr> evicted;
+    CachedFilePtr file = openFile(path, savedErrno);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++misses_;
+        if (file)
+        {
+            insert(path, file, now, &evicted);
+        }
+        else
+        {
+            // 文件已经被删除或不可访问，旧的缓存项也不再有效
+            auto it = entries_.find(path);
+            if (it != entries_.end())
+            {
+                evicted.push_back(std::move(it->second.file));
+                lru_.erase(it->second.lruPos);
+                entries_.erase(it);
+            }
+        }
+    }
+    return file;
+}
+
+void FileCache::insert(const std::string &path, const CachedFilePtr &file, Duration now, std::vector<CachedFilePtr> *evicted)
+{
+    auto it = entries_.find(path);
+    if (it != entries_.end())
+    {
+        evicted->push_back(std::move(it->second.file));
+        it->second.file = file;
+        it->second.validatedAt = now;
+        lru_.splice(lru_.begin(), lru_, it->second.lruPos);
+        return;
+    }
+
+    lru_.push_front(path);
+    entries_.emplace(path, Entry{file, now, lru_.begin()});
+    while (entries_.size() > maxOpenFiles_)
+    {
+        auto victim = entries_.find(lru_.back());
+        evicted->push_back(std::move(victim->second.file));
+        entries_.erase(victim);
+        lru_.pop_back();
+    }
+}
+
+void FileCache::invalidate(const std::string &path)
+{
+    CachedFilePtr file;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(path);
+    if (it != entries_.end())
+    {
+        file = std::move(it->second.file);
+        lru_.erase(it->second.lruPos);
+        entries_.erase(it);
+    }
+}
+
+void FileCache::clear()
+{
+    std::unordered_map<std::string, Entry> entries;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries.swap(entries_);
+        lru_.clear();
+    }
+}
+
+size_t FileCache::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+uint64_t FileCache::hits() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hits_;
+}
+
+uint64_t FileCache::misses() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return misses_;
+}
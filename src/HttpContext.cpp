@@ -0,0 +1,215 @@
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "HttpContext.hpp"
+#include "Buffer.hpp"
+
+namespace
+{
+// 在[begin, end)中查找请求头结尾的"\r\n\r\n"
+// SSE2每次比较16字节，只在命中'\r'的位置检查后面三个字节，请求头中'\r'只出现在行尾，候选位置很少
+const char *findHeaderEnd(const char *begin, const char *end)
+{
+    const char *p = begin;
+#ifdef __SSE2__
+    const __m128i cr = _mm_set1_epi8('\r');
+    // 保证块内任意位置之后还有3个字节可以比较
+    while (end - p >= 16 + 3)
+    {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, cr)));
+        while (mask != 0)
+        {
+            const char *candidate = p + __builtin_ctz(mask);
+            if (::memcmp(candidate, "\r\n\r\n", 4) == 0) return candidate;
+            mask &= mask - 1;
+        }
+        p += 16;
+    }
+#endif
+    for (; end - p >= 4; ++p)
+    {
+        if (*p == '\r' && ::memcmp(p, "\r\n\r\n", 4) == 0) return p;
+    }
+    return nullptr;
+}
+
+// 在[begin, end)中查找字节c，没有时返回end
+const char *findByte(const char *begin, const char *end, char c)
+{
+    const char *p = begin;
+#ifdef __SSE2__
+    const __m128i target = _mm_set1_epi8(c);
+    while (end - p >= 16)
+    {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, target)));
+        if (mask != 0) return p + __builtin_ctz(mask);
+        p += 16;
+    }
+#endif
+    for (; p < end; ++p)
+    {
+        if (*p == c) return p;
+    }
+    return end;
+}
+
+std::string_view trim(const char *begin, const char *end)
+{
+    while (begin < end && (*begin == ' ' || *begin == '\t')) ++begin;
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t')) --end;
+    return std::string_view(begin, end - begin);
+}
+
+HttpRequest::Method parseMethod(std::string_view m)
+{
+    switch (m.size())
+    {
+    case 3:
+        if (m == "GET") return HttpRequest::kGet;
+        if (m == "PUT") return HttpRequest::kPut;
+        break;
+    case 4:
+        if (m == "POST") return HttpRequest::kPost;
+        if (m == "HEAD") return HttpRequest::kHead;
+        break;
+    case 5:
+        if (m == "PATCH") return HttpRequest::kPatch;
+        break;
+    case 6:
+        if (m == "DELETE") return HttpRequest::kDelete;
+        break;
+    case 7:
+        if (m == "OPTIONS") return HttpRequest::kOptions;
+        break;
+    }
+    return HttpRequest::kInvalid;
+}
+
+// 解析Content-Length，只接受十进制数字，成功时返回0，否则返回应答的状态码
+int parseLength(std::string_view s, size_t limit, size_t *length)
+{
+    if (s.empty()) return 400;
+    size_t value = 0;
+    for (char c : s)
+    {
+        if (c < '0' || c > '9') return 400;
+        value = value * 10 + (c - '0');
+        if (value > limit) return 413;
+    }
+    *length = value;
+    return 0;
+}
+}
+
+HttpContext::ParseResult HttpContext::parse(const Buffer *buf, Timestamp receiveTime)
+{
+    const char *begin = buf->peek();
+    size_t readable = buf->readableBytes();
+
+    if (headerLength_ == 0)
+    {
+        // 上一次扫描的结尾可能是不完整的"\r\n\r\n"，回退3个字节
+        size_t start = scanned_ > 3 ? scanned_ - 3 : 0;
+        const char *headerEnd = findHeaderEnd(begin + start, begin + readable);
+        if (headerEnd == nullptr)
+        {
+            scanned_ = readable;
+            return readable > kMaxHeaderSize ? fail(431) : kIncomplete;
+        }
+        headerLength_ = headerEnd - begin + 4;
+        if (headerLength_ > kMaxHeaderSize) return fail(431);
+    }
+    else if (readable < headerLength_ + bodyLength_)
+    {
+        return kIncomplete;
+    }
+
+    // 请求头完整后，每次都重新生成视图，等待请求体期间Buffer可能已经扩容
+    request_.reset();
+    if (!parseHead(begin, begin + headerLength_ - 2)) return fail(errorStatus_ != 0 ? errorStatus_ : 400);
+    if (readable < headerLength_ + bodyLength_) return kIncomplete;
+
+    request_.body_ = std::string_view(begin + headerLength_, bodyLength_);
+    request_.receiveTime_ = receiveTime;
+    return kComplete;
+}
+
+HttpContext::ParseResult HttpContext::fail(int status)
+{
+    errorStatus_ = status;
+    return kError;
+}
+
+bool HttpContext::parseHead(const char *begin, const char *end)
+{
+    const char *lineEnd = findByte(begin, end, '\r');
+    if (lineEnd == end || lineEnd[1] != '\n' || !parseRequestLine(begin, lineEnd)) return false;
+
+    bodyLength_ = 0;
+    for (const char *line = lineEnd + 2; line < end; line = lineEnd + 2)
+    {
+        lineEnd = findByte(line, end, '\r');
+        if (lineEnd == end || lineEnd[1] != '\n') return false;
+        // 以空白开头的续行已被RFC 7230废弃
+        if (*line == ' ' || *line == '\t') return false;
+        const char *colon = findByte(line, lineEnd, ':');
+        if (colon == lineEnd || colon == line) return false;
+        std::string_view name(line, colon - line);
+        std::string_view value = trim(colon + 1, lineEnd);
+        request_.headers_.emplace_back(name, value);
+
+        if (HttpRequest::equalsIgnoreCase(name, "Content-Length"))
+        {
+            errorStatus_ = parseLength(value, kMaxBodySize, &bodyLength_);
+            if (errorStatus_ != 0) return false;
+        }
+        else if (HttpRequest::equalsIgnoreCase(name, "Transfer-Encoding"))
+        {
+            errorStatus_ = 501;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool HttpContext::parseRequestLine(const char *begin, const char *end)
+{
+    const char *space = findByte(begin, end, ' ');
+    if (space == end) return false;
+    request_.methodString_ = std::string_view(begin, space - begin);
+    request_.method_ = parseMethod(request_.methodString_);
+    if (request_.method_ == HttpRequest::kInvalid)
+    {
+        errorStatus_ = 501;
+        return false;
+    }
+
+    const char *targetBegin = space + 1;
+    const char *targetEnd = findByte(targetBegin, end, ' ');
+    if (targetEnd == end || targetEnd == targetBegin) return false;
+    const char *question = findByte(targetBegin, targetEnd, '?');
+    request_.path_ = std::string_view(targetBegin, question - targetBegin);
+    if (question != targetEnd)
+    {
+        request_.query_ = std::string_view(question + 1, targetEnd - question - 1);
+    }
+
+    std::string_view version(targetEnd + 1, end - targetEnd - 1);
+    if (version == "HTTP/1.1")
+    {
+        request_.version_ = HttpRequest::kHttp11;
+    }
+    else if (version == "HTTP/1.0")
+    {
+        request_.version_ = HttpRequest::kHttp10;
+    }
+    else
+    {
+        errorStatus_ = 505;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,68 @@
+#include "HttpResponse.hpp"
+#include "TcpConnection.hpp"
+#include "OutputQueue.hpp"
+
+const char *HttpResponse::statusMessageOf(int code)
+{
+    switch (code)
+    {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 206: return "Partial Content";
+    case 301: return "Moved Permanently";
+    case 302: return "Found";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 413: return "Payload Too Large";
+    case 416: return "Range Not Satisfiable";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 503: return "Service Unavailable";
+    case 505: return "HTTP Version Not Supported";
+    }
+    return "Unknown";
+}
+
+void HttpResponse::sendTo(const TcpConnectionPtr &conn, bool includeBody)
+{
+    std::string head;
+    head.reserve(128 + headers_.size() * 32 + (body_.size() < OutputQueue::kMinMoveSize ? body_.size() : 0));
+    head.append("HTTP/1.1 ").append(std::to_string(statusCode_)).append(" ");
+    head.append(statusMessage_.empty() ? statusMessageOf(statusCode_) : statusMessage_.c_str()).append("\r\n");
+    for (const auto &header : headers_)
+    {
+        head.append(header.first).append(": ").append(header.second).append("\r\n");
+    }
+    head.append("Content-Length: ").append(std::to_string(bodyLength_)).append("\r\n");
+    head.append(closeConnection_ ? "Connection: close\r\n\r\n" : "Connection: Keep-Alive\r\n\r\n");
+
+    if (!includeBody || bodyLength_ == 0)
+    {
+        conn->send(std::move(head));
+    }
+    else if (fileFd_ >= 0)
+    {
+        conn->send(std::move(head));
+        conn->sendFile(fileFd_, fileOffset_, bodyLength_, std::move(fileOwner_));
+    }
+    else if (sharedBody_)
+    {
+        conn->send(std::move(head));
+        conn->send(sharedBody_);
+    }
+    else if (body_.size() < OutputQueue::kMinMoveSize)
+    {
+        // 小响应体直接拼在响应头后面，输出队列中只占一个数据段
+        head.append(body_);
+        conn->send(std::move(head));
+    }
+    else
+    {
+        conn->send(std::move(head));
+        conn->send(std::move(body_));
+    }
+}
@@ -0,0 +1,93 @@
+#include "HttpServer.hpp"
+#include "HttpContext.hpp"
+#include "MyLog.hpp"
+
+namespace
+{
+void defaultHttpCallback(const HttpRequest &, HttpResponse *resp)
+{
+    resp->setStatusCode(404);
+    resp->setContentType("text/plain");
+    resp->setBody(std::string("not found\n"));
+}
+}
+
+HttpServer::HttpServer(EventLoop *loop,
+                       const InetAddress &listenAddr,
+                       const std::string &name,
+                       TcpServer::Option option)
+    : server_(loop, listenAddr, name, option),
+      httpCallback_(defaultHttpCallback)
+{
+    server_.setConnectionCallback(
+        std::bind(&HttpServer::onConnection, this, std::placeholders::_1));
+    server_.setMessageCallback(
+        std::bind(&HttpServer::onMessage, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+}
+
+void HttpServer::start()
+{
+    mylog::GetLogger("asynclogger")->Info("HttpServer[%s] starts listening on %s",
+            server_.name().c_str(), server_.ipPort().c_str());
+    server_.start();
+}
+
+void HttpServer::onConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        conn->setContext(HttpContext());
+    }
+}
+
+void HttpServer::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime)
+{
+    // 已经决定关闭的连接上后续到达的请求直接丢弃
+    HttpContext *context = std::any_cast<HttpContext>(conn->getMutableContext());
+    if (context == nullptr || !conn->connected())
+    {
+        buf->retrieveAll();
+        return;
+    }
+
+    // 本次读到的所有请求的响应合并为一次writev
+    conn->cork();
+    for (;;)
+    {
+        HttpContext::ParseResult result = context->parse(buf, receiveTime);
+        if (result == HttpContext::kIncomplete) break;
+        if (result == HttpContext::kError)
+        {
+            sendError(conn, context->errorStatus());
+            buf->retrieveAll();
+            break;
+        }
+
+        const HttpRequest &request = context->request();
+        HttpResponse response(!request.keepAlive());
+        httpCallback_(request, &response);
+        response.sendTo(conn, request.method() != HttpRequest::kHead);
+
+        // 请求的视图指向buf，处理完之后才能移除
+        buf->retrieve(context->consumed());
+        context->reset();
+        if (response.closeConnection())
+        {
+            conn->shutdown();
+            buf->retrieveAll();
+            break;
+        }
+        if (buf->readableBytes() == 0) break;
+    }
+    conn->uncork();
+}
+
+void HttpServer::sendError(const TcpConnectionPtr &conn, int status)
+{
+    HttpResponse response(true);
+    response.setStatusCode(status);
+    response.setContentType("text/plain");
+    response.setBody(std::string(HttpResponse::statusMessageOf(status)) + "\n");
+    response.sendTo(conn);
+    conn->shutdown();
+}
@@ -0,0 +1,307 @@
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <linux/time_types.h>
+#include "IoUringPoller.hpp"
+#include "Channel.hpp"
+#include "MyLog.hpp"
+
+const int NEW = -1;     // Channel还未被添加到Poller中
+const int ADDED = 1;
+
+namespace
+{
+int ioUringSetup(unsigned entries, io_uring_params* params)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+// 需要的特性：完成队列与提交队列共享mmap、完成队列不丢事件、带超时等待(5.11)
+// 以及multishot poll(5.13)，后者没有对应的特性位，用5.17引入的CQE_SKIP代替判断
+const unsigned kRequiredFeatures = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP |
+                                   IORING_FEAT_EXT_ARG | IORING_FEAT_CQE_SKIP;
+
+// poll请求的user_data：高32位为代数，低32位为fd；代数为0的请求（如POLL_REMOVE）的完成事件直接忽略
+uint64_t makeUserData(uint32_t generation, int fd)
+{
+    return (static_cast<uint64_t>(generation) << 32) | static_cast<uint32_t>(fd);
+}
+}
+
+bool IoUringPoller::isSupported()
+{
+    static const bool supported = []
+    {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        int fd = ioUringSetup(1, &params);
+        if (fd < 0) return false;
+        ::close(fd);
+        return (params.features & kRequiredFeatures) == kRequiredFeatures;
+    }();
+    return supported;
+}
+
+IoUringPoller::IoUringPoller(EventLoop* loop)
+    : Poller(loop),
+      ringFd_(-1),
+      sqRing_(nullptr),
+      sqRingSize_(0),
+      sqes_(nullptr),
+      sqesSize_(0),
+      sqLocalTail_(0),
+      nextGeneration_(1)
+{
+    setupRing();
+}
+
+IoUringPoller::~IoUringPoller()
+{
+    ::munmap(sqes_, sqesSize_);
+    ::munmap(sqRing_, sqRingSize_);
+    ::close(ringFd_);
+}
+
+void IoUringPoller::setupRing()
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    // 完成队列放大，multishot poll会在一轮中为同一个fd产生多个完成事件
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN;
+    params.cq_entries = kRingEntries * 4;
+    ringFd_ = ioUringSetup(kRingEntries, &params);
+    if (ringFd_ < 0 && errno == EINVAL)
+    {
+        // 旧内核不支持COOP_TASKRUN
+        params.flags &= ~IORING_SETUP_COOP_TASKRUN;
+        ringFd_ = ioUringSetup(kRingEntries, &params);
+    }
+    if (ringFd_ < 0)
+        mylog::GetLogger("asynclogger")->Fatal("io_uring_setup error: %s", strerror(errno));
+
+    // 提交队列和完成队列的环共享一次mmap
+    size_t sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    sqRingSize_ = sqSize > cqSize ? sqSize : cqSize;
+    sqRing_ = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     ringFd_, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED)
+        mylog::GetLogger("asynclogger")->Fatal("io_uring ring mmap error: %s", strerror(errno));
+
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = ::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ringFd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+        mylog::GetLogger("asynclogger")->Fatal("io_uring sqes mmap error: %s", strerror(errno));
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    char* ring = static_cast<char*>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned*>(ring + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(ring + params.sq_off.tail);
+    sqMask_ = *reinterpret_cast<unsigned*>(ring + params.sq_off.ring_mask);
+    sqEntries_ = params.sq_entries;
+    sqArray_ = reinterpret_cast<unsigned*>(ring + params.sq_off.array);
+    sqLocalTail_ = *sqTail_;
+
+    cqHead_ = reinterpret_cast<unsigned*>(ring + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(ring + params.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned*>(ring + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(ring + params.cq_off.cqes);
+}
+
+unsigned IoUringPoller::pendingSubmissions() const
+{
+    return sqLocalTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+}
+
+int IoUringPoller::enter(unsigned toSubmit, unsigned minComplete, unsigned flags, const void* arg, size_t argSize)
+{
+    // 发布本地填写的提交请求
+    __atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+    return static_cast<int>(::syscall(__NR_io_uring_enter, ringFd_, toSubmit, minComplete, flags, arg, argSize));
+}
+
+io_uring_sqe* IoUringPoller::getSqe()
+{
+    while (pendingSubmissions() >= sqEntries_)
+    {
+        if (enter(pendingSubmissions(), 0, 0, nullptr, 0) < 0 && errno != EINTR && errno != EBUSY)
+        {
+            mylog::GetLogger("asynclogger")->Fatal("io_uring_enter submit error: %s", strerror(errno));
+        }
+    }
+    unsigned index = sqLocalTail_ & sqMask_;
+    io_uring_sqe* sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqArray_[index] = index;
+    ++sqLocalTail_;
+    return sqe;
+}
+
+Timestamp IoUringPoller::poll(int timeoutMs, ChannelList* activeChannels)
+{
+    syncDirty();
+
+    __kernel_timespec ts;
+    io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    if (timeoutMs >= 0)
+    {
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000 * 1000;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+
+    // 提交本轮所有poll请求并等待至少一个完成事件，只需一次系统调用
+    int ret = enter(pendingSubmissions(), 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    int saveErrno = errno;
+    Timestamp now(Timestamp::now());
+
+    if (ret < 0 && saveErrno != EINTR && saveErrno != ETIME && saveErrno != EBUSY)
+    {
+        errno = saveErrno;
+        mylog::GetLogger("asynclogger")->Error("io_uring_enter error: %s", strerror(errno));
+    }
+    reapCompletions(activeChannels);
+    return now;
+}
+
+void IoUringPoller::reapCompletions(ChannelList* activeChannels)
+{
+    unsigned head = *cqHead_;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head)
+    {
+        const io_uring_cqe& cqe = cqes_[head & cqMask_];
+        uint32_t generation = static_cast<uint32_t>(cqe.user_data >> 32);
+        if (generation == 0) continue;
+
+        int fd = static_cast<int>(cqe.user_data & 0xffffffffu);
+        auto it = states_.find(fd);
+        // 已被移除或已重新提交的poll请求残留的完成事件
+        if (it == states_.end() || it->second.generation != generation) continue;
+
+        PollState& state = it->second;
+        if (!(cqe.flags & IORING_CQE_F_MORE))
+        {
+            // 单次poll已完成，或multishot poll被内核终止，下一轮重新提交
+            state.generation = 0;
+            markDirty(fd, state);
+        }
+        if (cqe.res <= 0)
+        {
+            if (cqe.res < 0 && cqe.res != -ECANCELED)
+                mylog::GetLogger("asynclogger")->Error("io_uring poll fd=%d error: %s", fd, strerror(-cqe.res));
+            continue;
+        }
+
+        if (state.revents == 0)
+        {
+            activeChannels->push_back(state.channel);
+            activeStates_.push_back(&state);
+        }
+        state.revents |= cqe.res;
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+
+    for (PollState* state : activeStates_)
+    {
+        state->channel->set_revents(state->revents);
+        state->revents = 0;
+    }
+    activeStates_.clear();
+}
+
+void IoUringPoller::markDirty(int fd, PollState& state)
+{
+    if (!state.dirty)
+    {
+        state.dirty = true;
+        dirty_.push_back(fd);
+    }
+}
+
+void IoUringPoller::syncDirty()
+{
+    for (int fd : dirty_)
+    {
+        auto it = states_.find(fd);
+        if (it == states_.end()) continue;
+
+        PollState& state = it->second;
+        state.dirty = false;
+        Channel* channel = state.channel;
+        int events = channel->pollEvents() & ~EPOLLET;
+        bool multishot = channel->edgeTriggered();
+
+        if (state.generation != 0 && (state.armedEvents != events || state.multishot != multishot))
+        {
+            prepPollRemove(fd, state.generation);
+            state.generation = 0;
+        }
+        if (state.generation == 0 && events != 0)
+        {
+            prepPollAdd(fd, state, events, multishot);
+        }
+    }
+    dirty_.clear();
+}
+
+void IoUringPoller::prepPollAdd(int fd, PollState& state, int events, bool multishot)
+{
+    if (++nextGeneration_ == 0) nextGeneration_ = 1;
+    state.generation = nextGeneration_;
+    state.armedEvents = events;
+    state.multishot = multishot;
+
+    io_uring_sqe* sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = static_cast<uint32_t>(events);
+    sqe->len = multishot ? IORING_POLL_ADD_MULTI : 0;
+    sqe->user_data = makeUserData(state.generation, fd);
+}
+
+void IoUringPoller::prepPollRemove(int fd, uint32_t generation)
+{
+    io_uring_sqe* sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = makeUserData(generation, fd);
+    sqe->user_data = 0;
+}
+
+// 监听事件的变化在下一次poll时统一提交
+void IoUringPoller::updateChannel(Channel* channel)
+{
+    int fd = channel->fd();
+    traceRing().record(TraceRing::kUpdate, fd, static_cast<uint32_t>(channel->pollEvents()));
+
+    if (channel->index() == NEW)
+    {
+        channels_[fd] = channel;
+        PollState state = {channel, 0, 0, false, false, 0};
+        states_[fd] = state;
+        channel->set_index(ADDED);
+    }
+    markDirty(fd, states_[fd]);
+}
+
+// 从Poller中删除Channel，提交中的poll请求随下一次poll撤销，fd被复用后旧请求的完成事件通过代数过滤
+void IoUringPoller::removeChannel(Channel* channel)
+{
+    int fd = channel->fd();
+    channels_.erase(fd);
+    traceRing().record(TraceRing::kRemove, fd, 0);
+
+    auto it = states_.find(fd);
+    if (it != states_.end())
+    {
+        if (it->second.generation != 0) prepPollRemove(fd, it->second.generation);
+        states_.erase(it);
+    }
+    channel->set_index(NEW);
+}
@@ -0,0 +1,133 @@
+#include <cstring>
+#include <endian.h>
+#include "LengthFieldCodec.hpp"
+#include "Buffer.hpp"
+#include "TcpConnection.hpp"
+#include "MyLog.hpp"
+
+LengthFieldCodec::LengthFieldCodec(const FramesCallback &cb, int lengthFieldBytes, size_t maxFrameLength)
+    : framesCallback_(cb),
+      lengthFieldBytes_(lengthFieldBytes),
+      maxFrameLength_(maxFrameLength)
+{
+    if (lengthFieldBytes != 1 && lengthFieldBytes != 2 && lengthFieldBytes != 4 && lengthFieldBytes != 8)
+    {
+        mylog::GetLogger("asynclogger")->Fatal("LengthFieldCodec: invalid length field size %d", lengthFieldBytes);
+    }
+    static_assert(Buffer::CHEAP_PREPEND >= 8, "Buffer prepend area must hold the largest length field");
+}
+
+uint64_t LengthFieldCodec::peekLength(const char *data) const
+{
+    switch (lengthFieldBytes_)
+    {
+    case 1:
+        return static_cast<uint8_t>(*data);
+    case 2:
+    {
+        uint16_t be;
+        ::memcpy(&be, data, sizeof(be));
+        return be16toh(be);
+    }
+    case 4:
+    {
+        uint32_t be;
+        ::memcpy(&be, data, sizeof(be));
+        return be32toh(be);
+    }
+    default:
+    {
+        uint64_t be;
+        ::memcpy(&be, data, sizeof(be));
+        return be64toh(be);
+    }
+    }
+}
+
+void LengthFieldCodec::prependLength(Buffer *buf, size_t length) const
+{
+    switch (lengthFieldBytes_)
+    {
+    case 1: buf->prependInt8(static_cast<int8_t>(length)); break;
+    case 2: buf->prependInt16(static_cast<int16_t>(length)); break;
+    case 4: buf->prependInt32(static_cast<int32_t>(length)); break;
+    default: buf->prependInt64(static_cast<int64_t>(length)); break;
+    }
+}
+
+void LengthFieldCodec::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime) const
+{
+    // 同一个codec可能被多个loop中的连接共享，每个线程复用自己的帧列表
+    thread_local FrameList frames;
+    frames.clear();
+
+    const char *data = buf->peek();
+    size_t readable = buf->readableBytes();
+    size_t consumed = 0;
+    bool invalid = false;
+    uint64_t length = 0;
+    while (readable - consumed >= static_cast<size_t>(lengthFieldBytes_))
+    {
+        length = peekLength(data + consumed);
+        if (length > maxFrameLength_)
+        {
+            invalid = true;
+            break;
+        }
+        if (readable - consumed - lengthFieldBytes_ < length) break;
+        frames.emplace_back(data + consumed + lengthFieldBytes_, static_cast<size_t>(length));
+        consumed += lengthFieldBytes_ + static_cast<size_t>(length);
+    }
+
+    // 非法长度头之前已经完整到达的帧仍然有效，先交给上层再报告错误
+    if (!frames.empty())
+    {
+        framesCallback_(conn, frames, receiveTime);
+        frames.clear();
+        buf->retrieve(consumed);
+    }
+
+    if (invalid)
+    {
+        buf->retrieveAll();
+        if (errorCallback_)
+        {
+            errorCallback_(conn, length);
+        }
+        else
+        {
+            mylog::GetLogger("asynclogger")->Error("LengthFieldCodec: %s sent an invalid frame length %llu",
+                    conn->name().c_str(), static_cast<unsigned long long>(length));
+            conn->forceClose();
+        }
+    }
+}
+
+bool LengthFieldCodec::checkSendLength(const TcpConnectionPtr &conn, size_t length) const
+{
+    // 8字节长度头可以表示任意size_t
+    bool fits = lengthFieldBytes_ == 8 || length < (static_cast<uint64_t>(1) << (8 * lengthFieldBytes_));
+    if (fits && length <= maxFrameLength_) return true;
+
+    mylog::GetLogger("asynclogger")->Error("LengthFieldCodec: refusing to send a %zu-byte frame to %s "
+            "(length field %d bytes, maxFrameLength %zu)", length, conn->name().c_str(), lengthFieldBytes_, maxFrameLength_);
+    return false;
+}
+
+bool LengthFieldCodec::send(const TcpConnectionPtr &conn, Buffer *buf) const
+{
+    if (!checkSendLength(conn, buf->readableBytes())) return false;
+    prependLength(buf, buf->readableBytes());
+    conn->send(buf);
+    return true;
+}
+
+bool LengthFieldCodec::send(const TcpConnectionPtr &conn, std::string_view payload) const
+{
+    if (!checkSendLength(conn, payload.size())) return false;
+    Buffer buf;
+    buf.append(payload.data(), payload.size());
+    prependLength(&buf, payload.size());
+    conn->send(&buf);
+    return true;
+}
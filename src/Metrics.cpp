@@ -0,0 +1,40 @@
+#include <cstdio>
+#include "Metrics.hpp"
+
+namespace metrics
+{
+void appendHeader(std::string *out, const char *name, const char *type, const char *help)
+{
+    out->append("# HELP ").append(name).append(" ").append(help).append("\n");
+    out->append("# TYPE ").append(name).append(" ").append(type).append("\n");
+}
+
+void appendValue(std::string *out, const char *name, const std::string &labels, double value)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.15g", value);
+    out->append(name);
+    if (!labels.empty()) out->append("{").append(labels).append("}");
+    out->append(" ").append(buf).append("\n");
+}
+
+void appendHistogram(std::string *out, const char *name, const std::string &labels, const LatencyHistogram &histogram)
+{
+    std::string bucketName = std::string(name) + "_bucket";
+    std::string prefix = labels.empty() ? std::string() : labels + ",";
+    char le[64];
+    uint64_t cumulative = 0;
+    for (int i = 0; i < LatencyHistogram::kBuckets - 1; ++i)
+    {
+        cumulative += histogram.bucket(i);
+        snprintf(le, sizeof(le), "le=\"%g\"", LatencyHistogram::upperBound(i) / 1e6);
+        appendValue(out, bucketName.c_str(), prefix + le, static_cast<double>(cumulative));
+    }
+    // 各个值分别读取，与写者并发时可能相差几个样本，最后一个桶以count为准保证单调
+    uint64_t count = histogram.count();
+    if (count < cumulative) count = cumulative;
+    appendValue(out, bucketName.c_str(), prefix + "le=\"+Inf\"", static_cast<double>(count));
+    appendValue(out, (std::string(name) + "_sum").c_str(), labels, histogram.sum() / 1e6);
+    appendValue(out, (std::string(name) + "_count").c_str(), labels, static_cast<double>(count));
+}
+}
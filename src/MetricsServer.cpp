@@ -0,0 +1,194 @@
+#include <cstring>
+#include <future>
+#include "MetricsServer.hpp"
+#include "EventLoop.hpp"
+#include "TcpServer.hpp"
+#include "TcpConnection.hpp"
+#include "Buffer.hpp"
+#include "Metrics.hpp"
+
+namespace
+{
+// 一个被监控的loop及其标签
+struct LoopTarget
+{
+    std::string labels;
+    EventLoop *loop;
+};
+
+// 请求头的最大长度，超过后关闭连接
+const size_t kMaxRequestSize = 8 * 1024;
+
+// 输出所有loop的同一个计数器或当前值
+template <typename Get>
+void appendLoopMetric(std::string *out, const std::vector<LoopTarget> &targets,
+                      const char *name, const char *type, const char *help, Get get)
+{
+    metrics::appendHeader(out, name, type, help);
+    for (const LoopTarget &target : targets)
+    {
+        metrics::appendValue(out, name, target.labels, static_cast<double>(get(target.loop)));
+    }
+}
+
+template <typename Get>
+void appendLoopHistogram(std::string *out, const std::vector<LoopTarget> &targets,
+                         const char *name, const char *help, Get get)
+{
+    metrics::appendHeader(out, name, "histogram", help);
+    for (const LoopTarget &target : targets)
+    {
+        metrics::appendHistogram(out, name, target.labels, get(target.loop));
+    }
+}
+
+uint64_t load(const std::atomic<uint64_t> &counter)
+{
+    return counter.load(std::memory_order_relaxed);
+}
+}
+
+MetricsServer::MetricsServer(const InetAddress &listenAddr, const std::string &name)
+    : listenAddr_(listenAddr),
+      name_(name),
+      thread_(EventLoopThread::ThreadInitCallback(), name),
+      loop_(nullptr)
+{
+}
+
+MetricsServer::~MetricsServer()
+{
+    if (loop_ != nullptr)
+    {
+        std::promise<void> done;
+        loop_->runInLoop([this, &done]
+        {
+            server_.reset();
+            done.set_value();
+        });
+        done.get_future().wait();
+    }
+}
+
+void MetricsServer::addServer(TcpServer *server)
+{
+    servers_.push_back(server);
+}
+
+void MetricsServer::start()
+{
+    loop_ = thread_.startLoop();
+    std::promise<void> started;
+    loop_->runInLoop([this, &started]
+    {
+        server_.reset(new TcpServer(loop_, listenAddr_, name_));
+        server_->setConnectionCallback([](const TcpConnectionPtr &) {});
+        server_->setMessageCallback(std::bind(&MetricsServer::onMessage, this,
+                                              std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+        server_->start();
+        started.set_value();
+    });
+    started.get_future().wait();
+}
+
+// 只处理请求行，忽略请求头和请求体
+void MetricsServer::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    const char *begin = buf->peek();
+    const char *end = begin + buf->readableBytes();
+    const char *headerEnd = static_cast<const char *>(memmem(begin, end - begin, "\r\n\r\n", 4));
+    if (headerEnd == nullptr)
+    {
+        if (buf->readableBytes() > kMaxRequestSize) conn->shutdown();
+        return;
+    }
+
+    std::string requestLine(begin, static_cast<const char *>(memchr(begin, '\r', end - begin)));
+    buf->retrieveAll();
+
+    std::string status;
+    std::string body;
+    if (requestLine.compare(0, 13, "GET /metrics ") == 0)
+    {
+        status = "200 OK";
+        body = render();
+    }
+    else
+    {
+        status = "404 Not Found";
+        body = "not found\n";
+    }
+
+    std::string response = "HTTP/1.1 " + status + "\r\n"
+                           "Content-Type: text/plain; version=0.0.4\r\n"
+                           "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                           "Connection: close\r\n\r\n";
+    response += body;
+    conn->send(std::move(response));
+    conn->shutdown();
+}
+
+std::string MetricsServer::render() const
+{
+    std::vector<LoopTarget> targets;
+    for (TcpServer *server : servers_)
+    {
+        std::vector<EventLoop*> loops = server->loops();
+        for (size_t i = 0; i < loops.size(); ++i)
+        {
+            targets.push_back({"server=\"" + server->name() + "\",loop=\"" + std::to_string(i) + "\"", loops[i]});
+        }
+    }
+
+    std::string out;
+    appendLoopMetric(&out, targets, "tcpserver_loop_iterations_total", "counter", "Event loop iterations.",
+                     [](EventLoop *loop) { return load(loop->loopStats().iterations); });
+    appendLoopMetric(&out, targets, "tcpserver_loop_events_total", "counter", "Active channels returned by poll.",
+                     [](EventLoop *loop) { return load(loop->loopStats().events); });
+    appendLoopMetric(&out, targets, "tcpserver_loop_functors_total", "counter", "Functors run by the loop.",
+                     [](EventLoop *loop) { return load(loop->loopStats().functors); });
+    appendLoopMetric(&out, targets, "tcpserver_loop_pending_functors", "gauge", "Cross-thread functors waiting to run.",
+                     [](EventLoop *loop) { return loop->loadStats().pendingFunctors.load(std::memory_order_relaxed); });
+    appendLoopMetric(&out, targets, "tcpserver_loop_connections", "gauge", "Connections owned by the loop.",
+                     [](EventLoop *loop) { return loop->loadStats().connections.load(std::memory_order_relaxed); });
+    appendLoopMetric(&out, targets, "tcpserver_loop_read_bytes_total", "counter", "Bytes read from connections.",
+                     [](EventLoop *loop) { return load(loop->readStats().bytes); });
+    appendLoopMetric(&out, targets, "tcpserver_loop_reads_total", "counter", "Reads that returned data.",
+                     [](EventLoop *loop) { return load(loop->readStats().reads); });
+    appendLoopMetric(&out, targets, "tcpserver_loop_written_bytes_total", "counter", "Bytes written to connections.",
+                     [](EventLoop *loop) { return load(loop->loopStats().bytesWritten); });
+    appendLoopMetric(&out, targets, "tcpserver_loop_writes_total", "counter", "Writes that sent data.",
+                     [](EventLoop *loop) { return load(loop->loopStats().writes); });
+    appendLoopMetric(&out, targets, "tcpserver_loop_output_backlog_bytes", "gauge", "Bytes queued in connection output queues.",
+                     [](EventLoop *loop) { return load(loop->loopStats().outputBacklog); });
+    appendLoopMetric(&out, targets, "tcpserver_loop_high_water_mark_total", "counter", "Times an output queue crossed its high water mark.",
+                     [](EventLoop *loop) { return load(loop->loopStats().highWaterMarkHits); });
+    appendLoopMetric(&out, targets, "tcpserver_loop_read_pauses_total", "counter", "Times backpressure paused reading on a source connection.",
+                     [](EventLoop *loop) { return load(loop->loopStats().readPauses); });
+    appendLoopHistogram(&out, targets, "tcpserver_loop_iteration_seconds", "Time from poll return to the end of functors.",
+                        [](EventLoop *loop) -> const LatencyHistogram & { return loop->loopStats().iterationTime; });
+    appendLoopHistogram(&out, targets, "tcpserver_loop_handler_seconds", "Time spent handling active channels per iteration.",
+                        [](EventLoop *loop) -> const LatencyHistogram & { return loop->loopStats().handlerTime; });
+    appendLoopHistogram(&out, targets, "tcpserver_loop_queue_latency_seconds", "Delay from queueInLoop on another thread to execution.",
+                        [](EventLoop *loop) -> const LatencyHistogram & { return loop->loopStats().queueLatency; });
+
+    metrics::appendHeader(&out, "tcpserver_accepted_total", "counter", "Connections accepted.");
+    for (TcpServer *server : servers_)
+    {
+        metrics::appendValue(&out, "tcpserver_accepted_total", "server=\"" + server->name() + "\"",
+                             static_cast<double>(server->acceptTotals().accepted));
+    }
+    metrics::appendHeader(&out, "tcpserver_accept_shed_total", "counter", "Connections dropped because file descriptors ran out.");
+    for (TcpServer *server : servers_)
+    {
+        metrics::appendValue(&out, "tcpserver_accept_shed_total", "server=\"" + server->name() + "\"",
+                             static_cast<double>(server->acceptTotals().shed));
+    }
+    metrics::appendHeader(&out, "tcpserver_accept_errors_total", "counter", "Failed accept calls.");
+    for (TcpServer *server : servers_)
+    {
+        metrics::appendValue(&out, "tcpserver_accept_errors_total", "server=\"" + server->name() + "\"",
+                             static_cast<double>(server->acceptTotals().errors));
+    }
+    return out;
+}
@@ -0,0 +1,144 @@
+#include <cerrno>
+#include <climits>
+#include <algorithm>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+#include "OutputQueue.hpp"
+
+void OutputQueue::append(const char *data, size_t len)
+{
+    if (len == 0) return;
+
+    // 队尾是自己持有的数据段且合并后不超过上限，直接追加
+    if (!segments_.empty())
+    {
+        Segment &tail = segments_.back();
+        if (!tail.shared && !tail.isFile() && tail.owned.size() + len <= kMaxCoalesceSize)
+        {
+            tail.owned.append(data, len);
+            tail.len += len;
+            readableBytes_ += len;
+            return;
+        }
+    }
+
+    segments_.emplace_back();
+    Segment &seg = segments_.back();
+    seg.owned.assign(data, len);
+    seg.offset = 0;
+    seg.len = len;
+    readableBytes_ += len;
+}
+
+void OutputQueue::append(std::string &&data, size_t offset)
+{
+    size_t len = data.size() - offset;
+    // 小数据拷贝到队尾比单独占用一个数据段更节省内存和iovec
+    if (len < kMinMoveSize)
+    {
+        append(data.data() + offset, len);
+        return;
+    }
+
+    segments_.emplace_back();
+    Segment &seg = segments_.back();
+    seg.owned = std::move(data);
+    seg.offset = offset;
+    seg.len = len;
+    readableBytes_ += len;
+}
+
+void OutputQueue::append(std::shared_ptr<const std::string> data, size_t offset, size_t len)
+{
+    if (len == 0) return;
+
+    segments_.emplace_back();
+    Segment &seg = segments_.back();
+    seg.shared = std::move(data);
+    seg.offset = offset;
+    seg.len = len;
+    readableBytes_ += len;
+}
+
+void OutputQueue::appendFile(int fd, off_t offset, size_t len, std::shared_ptr<const void> owner)
+{
+    if (len == 0) return;
+
+    segments_.emplace_back();
+    Segment &seg = segments_.back();
+    seg.fileFd = fd;
+    seg.fileOwner = std::move(owner);
+    seg.offset = static_cast<size_t>(offset);
+    seg.len = len;
+    readableBytes_ += len;
+}
+
+void OutputQueue::retrieve(size_t len)
+{
+    len = std::min(len, readableBytes_);
+    readableBytes_ -= len;
+    while (len > 0)
+    {
+        Segment &head = segments_.front();
+        if (len < head.len)
+        {
+            head.offset += len;
+            head.len -= len;
+            break;
+        }
+        len -= head.len;
+        segments_.pop_front();
+    }
+}
+
+void OutputQueue::retrieveAll()
+{
+    segments_.clear();
+    readableBytes_ = 0;
+}
+
+ssize_t OutputQueue::writeFd(int fd, int *saveErrno, size_t *attempted) const
+{
+    if (!segments_.empty() && segments_.front().isFile())
+    {
+        const Segment &head = segments_.front();
+        off_t offset = static_cast<off_t>(head.offset);
+        if (attempted != nullptr) *attempted = head.len;
+        ssize_t n = ::sendfile(fd, head.fileFd, &offset, head.len);
+        if (n < 0) *saveErrno = errno;
+        // 文件在发送期间被截断时sendfile返回0，当作错误处理，避免一直等待不会再到来的数据
+        if (n == 0) *saveErrno = EIO;
+        return n;
+    }
+
+    iovec vec[IOV_MAX];
+    int iovcnt = 0;
+    size_t total = 0;
+    // 遇到文件数据段时停止，文件数据段在前面的内存数据全部写出后再发送
+    auto it = segments_.begin();
+    for (; it != segments_.end() && !it->isFile() && iovcnt < IOV_MAX; ++it)
+    {
+        vec[iovcnt].iov_base = const_cast<char*>(it->data());
+        vec[iovcnt].iov_len = it->len;
+        total += it->len;
+        ++iovcnt;
+    }
+    if (attempted != nullptr) *attempted = total;
+
+    ssize_t n;
+    if (it != segments_.end() && it->isFile())
+    {
+        // 后面紧跟着文件数据，MSG_MORE让内核暂缓发出不满一个报文的数据（如响应头），与文件开头合并发送
+        msghdr msg = {};
+        msg.msg_iov = vec;
+        msg.msg_iovlen = iovcnt;
+        n = ::sendmsg(fd, &msg, MSG_MORE);
+    }
+    else
+    {
+        n = writev(fd, vec, iovcnt);
+    }
+    if (n < 0) *saveErrno = errno;
+    return n;
+}
@@ -0,0 +1,91 @@
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include "PollPoller.hpp"
+#include "Channel.hpp"
+#include "MyLog.hpp"
+
+PollPoller::PollPoller(EventLoop* loop)
+    : Poller(loop)
+{
+}
+
+Timestamp PollPoller::poll(int timeoutMs, ChannelList* activeChannels)
+{
+    int numEvents = ::poll(pollfds_.data(), pollfds_.size(), timeoutMs);
+    int saveErrno = errno;
+    Timestamp now(Timestamp::now());
+
+    if (numEvents > 0)
+    {
+        fillActiveChannels(numEvents, activeChannels);
+    }
+    else if (numEvents < 0 && saveErrno != EINTR)
+    {
+        errno = saveErrno;
+        mylog::GetLogger("asynclogger")->Error("poll error: %s", strerror(errno));
+    }
+    return now;
+}
+
+// 填写活跃的连接,即有事件需要处理的Channel,并设置Channel的revent
+void PollPoller::fillActiveChannels(int numEvents, ChannelList* activeChannels) const
+{
+    for (auto pfd = pollfds_.begin(); pfd != pollfds_.end() && numEvents > 0; ++pfd)
+    {
+        if (pfd->revents > 0)
+        {
+            --numEvents;
+            auto it = channels_.find(pfd->fd);
+            Channel* channel = it->second;
+            channel->set_revents(pfd->revents);
+            activeChannels->push_back(channel);
+        }
+    }
+}
+
+void PollPoller::updateChannel(Channel* channel)
+{
+    traceRing().record(TraceRing::kUpdate, channel->fd(), static_cast<uint32_t>(channel->events()));
+
+    if (channel->index() < 0)
+    {
+        // 新的Channel，追加到pollfds_末尾
+        struct pollfd pfd;
+        pfd.fd = channel->fd();
+        pfd.events = static_cast<short>(channel->events());
+        pfd.revents = 0;
+        pollfds_.push_back(pfd);
+        channel->set_index(static_cast<int>(pollfds_.size()) - 1);
+        channels_[pfd.fd] = channel;
+    }
+    else
+    {
+        struct pollfd& pfd = pollfds_[channel->index()];
+        pfd.fd = channel->fd();
+        pfd.events = static_cast<short>(channel->events());
+        pfd.revents = 0;
+        // 不监听任何事件时把fd置为负数，poll会忽略该项
+        if (channel->isNoneEvent()) pfd.fd = -channel->fd() - 1;
+    }
+}
+
+// 从Poller中删除Channel，把最后一项换到被删除的位置
+void PollPoller::removeChannel(Channel* channel)
+{
+    int fd = channel->fd();
+    traceRing().record(TraceRing::kRemove, fd, 0);
+
+    int idx = channel->index();
+    channels_.erase(fd);
+    if (idx < 0) return;
+    if (static_cast<size_t>(idx) != pollfds_.size() - 1)
+    {
+        int channelAtEnd = pollfds_.back().fd;
+        std::iter_swap(pollfds_.begin() + idx, pollfds_.end() - 1);
+        if (channelAtEnd < 0) channelAtEnd = -channelAtEnd - 1;
+        channels_[channelAtEnd]->set_index(idx);
+    }
+    pollfds_.pop_back();
+    channel->set_index(-1);
+}
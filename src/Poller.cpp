@@ -1,5 +1,6 @@
 #include "Poller.hpp"
 #include "Channel.hpp"
+#include "EventLoop.hpp"
 
 Poller::Poller(EventLoop* loop) : ownerLoop_(loop) {}
 
@@ -7,4 +8,9 @@ bool Poller::hasChannel(Channel* channel) const
 {
     auto it = channels_.find(channel->fd());
     return it != channels_.end() && it->second == channel;
-}
\ No newline at end of file
+}
+
+TraceRing &Poller::traceRing() const
+{
+    return ownerLoop_->traceRing();
+}
@@ -31,7 +31,7 @@ int Socket::Accept(InetAddress* peerAddr)
 {
     sockaddr_in client;
     bzero(&client, sizeof(client));
-    socklen_t client_len;
+    socklen_t client_len = sizeof(client);
     int connfd = accept4(sockfd_, (sockaddr*)&client, &client_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
     if (connfd >= 0) peerAddr->setSockAddr(client);
     return connfd;
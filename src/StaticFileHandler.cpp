@@ -0,0 +1,233 @@
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include "StaticFileHandler.hpp"
+#include "MyLog.hpp"
+
+namespace
+{
+void setErrorResponse(HttpResponse *response, int status)
+{
+    response->setStatusCode(status);
+    response->setContentType("text/plain");
+    response->setBody(std::string(HttpResponse::statusMessageOf(status)) + "\n");
+}
+
+int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// 解析非负十进制整数，溢出或含有其他字符时返回false
+bool parseOffset(std::string_view s, off_t *out)
+{
+    if (s.empty() || s.size() > 18) return false;
+    off_t value = 0;
+    for (char c : s)
+    {
+        if (c < '0' || c > '9') return false;
+        value = value * 10 + (c - '0');
+    }
+    *out = value;
+    return true;
+}
+}
+
+StaticFileHandler::StaticFileHandler(const std::string &root, std::shared_ptr<FileCache> cache)
+    : root_(root),
+      cache_(cache ? std::move(cache) : std::make_shared<FileCache>())
+{
+    while (root_.size() > 1 && root_.back() == '/') root_.pop_back();
+}
+
+const char *StaticFileHandler::contentTypeOf(std::string_view path)
+{
+    static const struct { const char *ext; const char *type; } kTypes[] = {
+        {".html", "text/html; charset=utf-8"},
+        {".htm", "text/html; charset=utf-8"},
+        {".css", "text/css"},
+        {".js", "application/javascript"},
+        {".json", "application/json"},
+        {".txt", "text/plain; charset=utf-8"},
+        {".xml", "application/xml"},
+        {".png", "image/png"},
+        {".jpg", "image/jpeg"},
+        {".jpeg", "image/jpeg"},
+        {".gif", "image/gif"},
+        {".svg", "image/svg+xml"},
+        {".ico", "image/x-icon"},
+        {".webp", "image/webp"},
+        {".wasm", "application/wasm"},
+        {".pdf", "application/pdf"},
+        {".mp4", "video/mp4"},
+    };
+    size_t dot = path.rfind('.');
+    if (dot != std::string_view::npos && path.find('/', dot) == std::string_view::npos)
+    {
+        std::string_view ext = path.substr(dot);
+        for (const auto &entry : kTypes)
+        {
+            if (HttpRequest::equalsIgnoreCase(ext, entry.ext)) return entry.type;
+        }
+    }
+    return "application/octet-stream";
+}
+
+bool StaticFileHandler::decodePath(std::string_view path, std::string *out)
+{
+    if (path.empty() || path[0] != '/') return false;
+
+    out->clear();
+    out->reserve(path.size());
+    for (size_t i = 0; i < path.size(); ++i)
+    {
+        char c = path[i];
+        if (c == '%')
+        {
+            int hi = i + 2 < path.size() ? hexValue(path[i + 1]) : -1;
+            int lo = hi >= 0 ? hexValue(path[i + 2]) : -1;
+            if (lo < 0) return false;
+            c = static_cast<char>(hi * 16 + lo);
+            i += 2;
+        }
+        if (c == '\0') return false;
+        out->push_back(c);
+    }
+
+    // 解码后逐段检查，拒绝任何".."段
+    size_t start = 0;
+    while (start < out->size())
+    {
+        size_t end = out->find('/', start);
+        if (end == std::string::npos) end = out->size();
+        if (end - start == 2 && (*out)[start] == '.' && (*out)[start + 1] == '.') return false;
+        start = end + 1;
+    }
+    return true;
+}
+
+int StaticFileHandler::parseRange(std::string_view range, off_t size, off_t *first, off_t *last)
+{
+    static const std::string_view kPrefix = "bytes=";
+    if (range.size() <= kPrefix.size() || !HttpRequest::equalsIgnoreCase(range.substr(0, kPrefix.size()), kPrefix)) return 0;
+    range.remove_prefix(kPrefix.size());
+    if (range.find(',') != std::string_view::npos) return 0;
+
+    size_t dash = range.find('-');
+    if (dash == std::string_view::npos) return 0;
+    std::string_view firstPart = range.substr(0, dash);
+    std::string_view lastPart = range.substr(dash + 1);
+
+    if (firstPart.empty())
+    {
+        // bytes=-n：最后n个字节
+        off_t suffix;
+        if (!parseOffset(lastPart, &suffix)) return 0;
+        if (suffix == 0 || size == 0) return -1;
+        *first = suffix >= size ? 0 : size - suffix;
+        *last = size - 1;
+        return 1;
+    }
+
+    if (!parseOffset(firstPart, first)) return 0;
+    if (lastPart.empty())
+    {
+        *last = size - 1;
+    }
+    else
+    {
+        if (!parseOffset(lastPart, last) || *last < *first) return 0;
+        if (*last >= size) *last = size - 1;
+    }
+    if (*first >= size) return -1;
+    return 1;
+}
+
+std::string StaticFileHandler::httpDate(time_t t)
+{
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    char buf[32];
+    size_t n = strftime(buf, sizeof buf, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return std::string(buf, n);
+}
+
+void StaticFileHandler::operator()(const HttpRequest &request, HttpResponse *response) const
+{
+    if (request.method() != HttpRequest::kGet && request.method() != HttpRequest::kHead)
+    {
+        setErrorResponse(response, 405);
+        response->addHeader("Allow", "GET, HEAD");
+        return;
+    }
+
+    std::string path;
+    if (!decodePath(request.path(), &path))
+    {
+        setErrorResponse(response, 403);
+        return;
+    }
+    if (path.back() == '/') path.append("index.html");
+
+    int savedErrno = 0;
+    CachedFilePtr file = cache_->open(root_ + path, &savedErrno);
+    if (!file)
+    {
+        if (savedErrno == EISDIR)
+        {
+            // 目录需要以'/'结尾，相对路径才能正确解析
+            response->setStatusCode(301);
+            response->addHeader("Location", std::string(request.path()) + "/");
+        }
+        else if (savedErrno == ENOENT || savedErrno == ENOTDIR)
+        {
+            setErrorResponse(response, 404);
+        }
+        else if (savedErrno == EACCES)
+        {
+            setErrorResponse(response, 403);
+        }
+        else
+        {
+            mylog::GetLogger("asynclogger")->Warn("StaticFileHandler open %s failed: %s", path.c_str(), strerror(savedErrno));
+            setErrorResponse(response, 500);
+        }
+        return;
+    }
+
+    std::string lastModified = httpDate(file->mtime());
+    if (request.getHeader("If-Modified-Since") == lastModified)
+    {
+        response->setStatusCode(304);
+        response->addHeader("Last-Modified", lastModified);
+        return;
+    }
+
+    off_t size = file->size();
+    off_t first = 0;
+    off_t last = size - 1;
+    std::string_view range = request.getHeader("Range");
+    int rangeResult = range.empty() ? 0 : parseRange(range, size, &first, &last);
+    if (rangeResult < 0)
+    {
+        setErrorResponse(response, 416);
+        response->addHeader("Content-Range", "bytes */" + std::to_string(size));
+        return;
+    }
+
+    response->setContentType(contentTypeOf(path));
+    response->addHeader("Last-Modified", lastModified);
+    response->addHeader("Accept-Ranges", "bytes");
+    if (rangeResult > 0)
+    {
+        response->setStatusCode(206);
+        response->addHeader("Content-Range",
+            "bytes " + std::to_string(first) + "-" + std::to_string(last) + "/" + std::to_string(size));
+    }
+    size_t length = size > 0 ? static_cast<size_t>(last - first + 1) : 0;
+    int fd = file->fd();
+    response->setFileBody(fd, first, length, std::move(file));
+}
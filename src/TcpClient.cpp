@@ -0,0 +1,124 @@
+#include <cstring>
+#include <sys/socket.h>
+#include "TcpClient.hpp"
+#include "EventLoop.hpp"
+#include "Buffer.hpp"
+#include "MyLog.hpp"
+
+namespace
+{
+InetAddress localAddressOf(int sockfd)
+{
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof(addr));
+    socklen_t len = sizeof(addr);
+    if (::getsockname(sockfd, (sockaddr*)&addr, &len) < 0)
+        mylog::GetLogger("asynclogger")->Error("TcpClient getsockname error: %s", strerror(errno));
+    return InetAddress(addr);
+}
+
+InetAddress peerAddressOf(int sockfd)
+{
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof(addr));
+    socklen_t len = sizeof(addr);
+    if (::getpeername(sockfd, (sockaddr*)&addr, &len) < 0)
+        mylog::GetLogger("asynclogger")->Error("TcpClient getpeername error: %s", strerror(errno));
+    return InetAddress(addr);
+}
+
+// TcpClient销毁后仍存活的连接使用的关闭回调，不再访问TcpClient
+void removeDetachedConnection(const TcpConnectionPtr &conn)
+{
+    conn->getLoop()->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+}
+}
+
+TcpClient::TcpClient(EventLoop *loop, const InetAddress &serverAddr, const std::string &nameArg)
+    : loop_(loop),
+      connector_(new Connector(loop, serverAddr)),
+      name_(nameArg),
+      connectionCallback_([](const TcpConnectionPtr &) {}),
+      messageCallback_([](const TcpConnectionPtr &, Buffer *buf, Timestamp) { buf->retrieveAll(); }),
+      idleTimeout_(0.0),
+      readBudget_(TcpConnection::kDefaultReadBudget),
+      backpressureHigh_(0),
+      backpressureLow_(0),
+      edgeTriggered_(false),
+      retry_(false),
+      connect_(false),
+      nextConnId_(1)
+{
+    connector_->setNewConnectionCallback(std::bind(&TcpClient::newConnection, this, std::placeholders::_1));
+}
+
+TcpClient::~TcpClient()
+{
+    TcpConnectionPtr conn(connection());
+    if (conn)
+    {
+        // 连接可能比TcpClient存活得更久，关闭回调不能再指向this
+        conn->setCloseCallback(removeDetachedConnection);
+        conn->forceClose();
+    }
+    // 在loop线程中同步执行，之后Connector不会再调用newConnection
+    connector_->stop();
+}
+
+void TcpClient::connect()
+{
+    mylog::GetLogger("asynclogger")->Info("TcpClient::connect [%s] - connecting to %s",
+            name_.c_str(), connector_->serverAddress().toIpPort().c_str());
+    connect_ = true;
+    connector_->start();
+}
+
+void TcpClient::disconnect()
+{
+    connect_ = false;
+    TcpConnectionPtr conn(connection());
+    if (conn) conn->shutdown();
+}
+
+void TcpClient::stop()
+{
+    connect_ = false;
+    connector_->stop();
+}
+
+void TcpClient::newConnection(int sockfd)
+{
+    InetAddress peerAddr(peerAddressOf(sockfd));
+    std::string connName = name_ + "-" + peerAddr.toIpPort() + "#" + std::to_string(nextConnId_++);
+    TcpConnectionPtr conn(new TcpConnection(loop_, connName, sockfd, localAddressOf(sockfd), peerAddr));
+
+    conn->setConnectionCallback(connectionCallback_);
+    conn->setMessageCallback(messageCallback_);
+    conn->setWriteCompleteCallback(writeCompleteCallback_);
+    conn->setIdleTimeout(idleTimeout_);
+    conn->setReadBudget(readBudget_);
+    conn->setEdgeTriggered(edgeTriggered_);
+    conn->setBackpressure(backpressureHigh_, backpressureLow_);
+    conn->setCloseCallback(std::bind(&TcpClient::removeConnection, this, std::placeholders::_1));
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connection_ = conn;
+    }
+    conn->connectEstablished();
+}
+
+void TcpClient::removeConnection(const TcpConnectionPtr &conn)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connection_.reset();
+    }
+    // 当前仍在Channel的事件处理中，Channel的销毁需要放到本轮事件处理之后
+    loop_->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+    if (retry_ && connect_)
+    {
+        mylog::GetLogger("asynclogger")->Info("TcpClient::removeConnection [%s] - reconnecting to %s",
+                name_.c_str(), connector_->serverAddress().toIpPort().c_str());
+        connector_->restart();
+    }
+}
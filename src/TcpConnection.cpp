@@ -12,6 +12,7 @@
 #include "Socket.hpp"
 #include "Channel.hpp"
 #include "EventLoop.hpp"
+#include "TimingWheel.hpp"
 #include "MyLog.hpp"
 
 static EventLoop* CheckLoopNotNull(EventLoop *loop)
@@ -30,11 +31,27 @@ TcpConnection::TcpConnection(EventLoop *loop,
       name_(nameArg),
       state_(kConnecting),
       reading_(true),
+      readHolds_(0),
+      closed_(false),
+      corked_(false),
+      writeCompletePending_(false),
       socket_(new Socket(sockfd)),
       channel_(new Channel(loop, sockfd)),
       localAddr_(localAddr),
       peerAddr_(peerAddr),
-      highWaterMark_(64 * 1024 * 1024) // 64M
+      highWaterMark_(64 * 1024 * 1024), // 64M
+      idleTimeout_(0.0),
+      idleEntry_(nullptr),
+      readHint_(kMinReadHint),
+      readShrinkCount_(0),
+      readBudget_(kDefaultReadBudget),
+      bytesReceived_(0),
+      bytesSent_(0),
+      backpressureHigh_(0),
+      backpressureLow_(0),
+      hasBackpressureSource_(false),
+      backpressureActive_(false),
+      inputBuffer_(Buffer::INIT_SIZE, loop->bufferPool())
 {
     // 将TcpConnection的成员函数作为Channel的回调函数
     channel_->setReadCallback(
@@ -64,9 +81,63 @@ void TcpConnection::send(const std::string &buf)
             sendInLoop(buf.c_str(), buf.size());
         }
         else
+        {
+            // buf在回调执行时可能已经失效，拷贝一份交给loop线程
+            send(std::string(buf));
+        }
+    }
+}
+
+void TcpConnection::send(std::string &&buf)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendStringInLoop(buf);
+        }
+        else
+        {
+            // 将string的所有权转移到回调中，不拷贝数据
+            auto data = std::make_shared<std::string>(std::move(buf));
+            TcpConnectionPtr self(shared_from_this());
+            loop_->queueInLoop([self, data]() { self->sendStringInLoop(*data); });
+        }
+    }
+}
+
+void TcpConnection::send(Buffer *buf)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendInLoop(buf->peek(), buf->readableBytes());
+            buf->retrieveAll();
+        }
+        else
+        {
+            // 与调用者的Buffer交换，调用者得到一个空Buffer
+            auto data = std::make_shared<Buffer>();
+            data->swap(*buf);
+            TcpConnectionPtr self(shared_from_this());
+            loop_->queueInLoop([self, data]() { self->sendInLoop(data->peek(), data->readableBytes()); });
+        }
+    }
+}
+
+void TcpConnection::send(const std::shared_ptr<const std::string> &buf)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendSharedInLoop(buf);
+        }
+        else
         {
             loop_->queueInLoop(
-                std::bind(&TcpConnection::sendInLoop, this, buf.c_str(), buf.size()));
+                std::bind(&TcpConnection::sendSharedInLoop, shared_from_this(), buf));
         }
     }
 }
@@ -74,31 +145,73 @@ void TcpConnection::send(const std::string &buf)
 // 发送数据
 void TcpConnection::sendInLoop(const void* data, size_t len)
 {
-    ssize_t nwrote = 0;
-    size_t remaining = len;
     bool faultError = false;
+    size_t nwrote = writeDirectly(data, len, &faultError);
+    size_t remaining = len - nwrote;
+
+    // 没有将数据全部发送出去，此时需要将未发送的数据添加到输出缓冲区中，等待内核缓冲区有空间后
+    // 再通过Poller通知相应的Channel，Channel会调用写回调函数将输出缓冲区的数据发送出去
+    if (!faultError && remaining > 0)
+    {
+        size_t oldLen = outputQueue_.readableBytes(); // 当前输出缓冲区剩余的待发送数据
+        outputQueue_.append(static_cast<const char*>(data) + nwrote, remaining);
+        queueOutput(oldLen);
+    }
+}
+
+void TcpConnection::sendStringInLoop(std::string &data)
+{
+    bool faultError = false;
+    size_t nwrote = writeDirectly(data.data(), data.size(), &faultError);
+
+    if (!faultError && nwrote < data.size())
+    {
+        size_t oldLen = outputQueue_.readableBytes();
+        // 剩余数据直接移动到输出队列中
+        outputQueue_.append(std::move(data), nwrote);
+        queueOutput(oldLen);
+    }
+}
+
+void TcpConnection::sendSharedInLoop(const std::shared_ptr<const std::string> &data)
+{
+    bool faultError = false;
+    size_t nwrote = writeDirectly(data->data(), data->size(), &faultError);
+
+    if (!faultError && nwrote < data->size())
+    {
+        size_t oldLen = outputQueue_.readableBytes();
+        // 输出队列引用剩余的数据，不拷贝
+        outputQueue_.append(data, nwrote, data->size() - nwrote);
+        queueOutput(oldLen);
+    }
+}
+
+// 输出队列为空时直接写socket，返回写入的字节数
+size_t TcpConnection::writeDirectly(const void* data, size_t len, bool *faultError)
+{
+    ssize_t nwrote = 0;
 
     // 断开连接则直接返回
     if (state_ == kDisconnected)
     {
         mylog::GetLogger("asynclogger")->Error("disconnected, give up writing");
-        return;
+        *faultError = true;
+        return 0;
     }
 
     // 该频道没有在监听写事件且输出缓冲区没有待发送数据，说明现在内核缓冲区有空间可以写入数据
-    // 此时可以直接调用write
-    if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
+    // 此时可以直接调用write，cork期间数据全部进入输出队列
+    if (!corked_ && !channel_->isWriting() && outputQueue_.readableBytes() == 0)
     {
         nwrote = write(channel_->fd(), data, len);
         if (nwrote >= 0)
         {
-            remaining -= nwrote;
-            // 全部发送完毕且设置了写完成回调函数
-            if (remaining == 0 && writeCompleteCallback_)
+            recordWrite(nwrote);
+            // 全部发送完毕
+            if (static_cast<size_t>(nwrote) == len)
             {
-                // 将写完成回调函数作为任务交给TcpConnection对应的subLoop完成
-                loop_->queueInLoop(
-                    std::bind(writeCompleteCallback_, shared_from_this()));
+                notifyWriteComplete();
             }
         }
         else // nwrote < 0
@@ -108,27 +221,126 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
             if (errno != EWOULDBLOCK)
             {
                 mylog::GetLogger("asynclogger")->Error("TcpConnection::sendInLoop error");
-                if (errno == EPIPE || errno == ECONNRESET) faultError = true;
+                if (errno == EPIPE || errno == ECONNRESET) *faultError = true;
             }
         }
     }
+    return static_cast<size_t>(nwrote);
+}
 
-    // 没有将数据全部发送出去，此时需要将未发送的数据添加到输出缓冲区中，等待内核缓冲区有空间后
-    // 再通过Poller通知相应的Channel，Channel会调用写回调函数将输出缓冲区的数据发送出去
-    if (!faultError && remaining > 0)
+// 数据加入输出队列后调用，oldLen为加入前队列中的数据量
+void TcpConnection::queueOutput(size_t oldLen)
+{
+    size_t newLen = outputQueue_.readableBytes();
+    EventLoop::LoopStats &stats = loop_->loopStats();
+    metricAdd(stats.outputBacklog, newLen - oldLen);
+    if (newLen >= highWaterMark_ && oldLen < highWaterMark_) metricAdd(stats.highWaterMarkHits);
+    // 通过高水位阈值控制数据的发送速率
+    if (newLen >= highWaterMark_ && oldLen < highWaterMark_ && highWaterMarkCallback_)
+    {
+        loop_->queueInLoop(
+            std::bind(highWaterMarkCallback_, shared_from_this(), newLen));
+    }
+    checkBackpressure();
+    // cork期间由uncork先尝试直接写出，写不完时再注册写事件
+    if (!corked_ && !channel_->isWriting())
+    {
+        channel_->enableWriting(); // 注册写事件
+    }
+}
+
+void TcpConnection::uncork()
+{
+    corked_ = false;
+    if (channel_->isWriting() || outputQueue_.empty() || closed_) return;
+
+    bool budgetExhausted = false;
+    if (drainOutput(&budgetExhausted) > 0)
+    {
+        touchIdleEntry();
+    }
+    if (closed_) return;
+
+    if (outputQueue_.empty())
+    {
+        outputDrained();
+    }
+    else
+    {
+        channel_->enableWriting();
+    }
+}
+
+// 依次写出输出队列中的内存和文件数据段，直到队列为空、发送缓冲区已满或达到kWriteBudget
+size_t TcpConnection::drainOutput(bool *budgetExhausted)
+{
+    size_t written = 0;
+    while (!outputQueue_.empty())
     {
-        size_t oldLen = outputBuffer_.readableBytes(); // 当前输出缓冲区剩余的待发送数据
-        // 通过高水位阈值控制数据的发送速率
-        if (oldLen + remaining >= highWaterMark_ && oldLen < highWaterMark_ && highWaterMark_)
+        if (written >= kWriteBudget)
         {
-            loop_->queueInLoop(
-                std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
+            *budgetExhausted = true;
+            break;
         }
-        outputBuffer_.append((char*)data + nwrote, remaining);
-        if (!channel_->isWriting())
+
+        int savedErrno = 0;
+        size_t attempted = 0;
+        ssize_t n = outputQueue_.writeFd(channel_->fd(), &savedErrno, &attempted);
+        if (n <= 0)
         {
-            channel_->enableWriting(); // 注册写事件
+            if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK)
+            {
+                break;
+            }
+            if (outputQueue_.frontIsFile())
+            {
+                // 文件数据段无法继续发送（文件被截断、fd不支持sendfile或已被关闭），已经发出的响应不完整，只能关闭连接
+                mylog::GetLogger("asynclogger")->Warn("TcpConnection %s file segment failed: %s, closing",
+                        name_.c_str(), strerror(savedErrno));
+                forceCloseInLoop();
+            }
+            else
+            {
+                mylog::GetLogger("asynclogger")->Error("TcpConnection::drainOutput error: %s", strerror(savedErrno));
+            }
+            break;
         }
+
+        written += n;
+        recordWrite(n);
+        metricSub(loop_->loopStats().outputBacklog, n);
+        outputQueue_.retrieve(n);
+        // 没有写完提交的数据说明发送缓冲区已满，等待下一次可写事件
+        if (static_cast<size_t>(n) < attempted) break;
+    }
+    if (written > 0)
+    {
+        checkBackpressure();
+    }
+    return written;
+}
+
+void TcpConnection::notifyWriteComplete()
+{
+    // 同一轮loop中多次写完只通知一次，回调执行时仍有待发送数据则等队列写空后再通知
+    if (!writeCompleteCallback_ || writeCompletePending_) return;
+    writeCompletePending_ = true;
+    TcpConnectionPtr self(shared_from_this());
+    loop_->queueInLoop([self]() {
+        self->writeCompletePending_ = false;
+        if (self->outputQueue_.empty())
+        {
+            self->writeCompleteCallback_(self);
+        }
+    });
+}
+
+void TcpConnection::outputDrained()
+{
+    notifyWriteComplete();
+    if (state_ == kDisconnected)
+    {
+        shutdownInLoop(); // 关闭TcpConnection
     }
 }
 
@@ -144,17 +356,154 @@ void TcpConnection::shutdown()
 
 void TcpConnection::shutdownInLoop()
 {
-    if (!channel_->isWriting()) // 没有待发送数据
+    if (!channel_->isWriting() && outputQueue_.empty()) // 没有待发送数据，cork期间数据可能还在队列中
     {
         socket_->shutdownWrite();
     }
 }
 
+void TcpConnection::forceClose()
+{
+    // shutdown之后状态为kDisconnected，但连接仍未关闭，对端不关闭或不读取时只能由这里关闭
+    // 是否已经关闭由loop线程中的closed_判断
+    if (state_ == kConnecting) return;
+    int expected = kConnected;
+    state_.compare_exchange_strong(expected, KDisconnecting);
+    loop_->queueInLoop(
+        std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
+}
+
+void TcpConnection::forceCloseInLoop()
+{
+    if (!closed_ && state_ != kConnecting)
+    {
+        // 与对端关闭连接的处理相同
+        handleClose();
+    }
+}
+
+void TcpConnection::setTcpNoDelay(bool on)
+{
+    socket_->setTcpNoDelay(on);
+}
+
+void TcpConnection::touchIdleEntry()
+{
+    if (idleEntry_ != nullptr)
+    {
+        loop_->timingWheel()->refresh(idleEntry_);
+    }
+}
+
+void TcpConnection::setBackpressure(size_t highMark, size_t lowMark)
+{
+    backpressureHigh_ = highMark;
+    backpressureLow_ = clampBackpressureLow(highMark, lowMark);
+}
+
+size_t TcpConnection::clampBackpressureLow(size_t highMark, size_t lowMark)
+{
+    if (highMark == 0 || lowMark < highMark) return lowMark;
+    mylog::GetLogger("asynclogger")->Warn("backpressure lowMark %zu >= highMark %zu, using %zu",
+                                          lowMark, highMark, highMark / 2);
+    return highMark / 2;
+}
+
+void TcpConnection::setEdgeTriggered(bool on)
+{
+    // poll等不支持边沿触发的实现下保持水平触发
+    channel_->setEdgeTriggered(on && loop_->supportsEdgeTriggered());
+}
+
+void TcpConnection::startRead()
+{
+    loop_->runInLoop(std::bind(&TcpConnection::setReadingInLoop, shared_from_this(), true));
+}
+
+void TcpConnection::stopRead()
+{
+    loop_->runInLoop(std::bind(&TcpConnection::setReadingInLoop, shared_from_this(), false));
+}
+
+void TcpConnection::setReadingInLoop(bool on)
+{
+    reading_ = on;
+    // 连接建立时再注册
+    if (state_ != kConnecting) updateReading();
+}
+
+void TcpConnection::updateReading()
+{
+    bool want = reading_ && readHolds_ == 0 && !closed_;
+    if (want && !channel_->isReading())
+    {
+        channel_->enableReading();
+        if (channel_->edgeTriggered())
+        {
+            // 停止期间到达的数据已经消耗了可读边沿，需要主动读取一次
+            loop_->queueInLoop(
+                std::bind(&TcpConnection::handleRead, shared_from_this(), Timestamp::now()));
+        }
+    }
+    else if (!want && channel_->isReading())
+    {
+        channel_->disableReading();
+    }
+}
+
+void TcpConnection::holdRead()
+{
+    loop_->runInLoop(std::bind(&TcpConnection::adjustReadHolds, shared_from_this(), 1));
+}
+
+void TcpConnection::releaseRead()
+{
+    loop_->runInLoop(std::bind(&TcpConnection::adjustReadHolds, shared_from_this(), -1));
+}
+
+void TcpConnection::adjustReadHolds(int delta)
+{
+    readHolds_ += delta;
+    if (state_ != kConnecting) updateReading();
+}
+
+void TcpConnection::checkBackpressure()
+{
+    if (backpressureHigh_ == 0) return;
+
+    size_t len = outputQueue_.readableBytes();
+    if (!backpressureActive_ && len >= backpressureHigh_)
+    {
+        TcpConnectionPtr source(hasBackpressureSource_ ? backpressureSource_.lock() : shared_from_this());
+        if (!source) return; // 上游连接已经销毁
+        backpressureActive_ = true;
+        heldSource_ = source;
+        metricAdd(loop_->loopStats().readPauses);
+        source->holdRead();
+    }
+    else if (backpressureActive_ && len <= backpressureLow_)
+    {
+        backpressureActive_ = false;
+        TcpConnectionPtr source(heldSource_.lock());
+        heldSource_.reset();
+        if (source) source->releaseRead();
+    }
+}
+
 void TcpConnection::connectEstablished()
 {
     setState(kConnected);
+    // 在loop线程中计入，与connectDestroyed成对；连接对象可能比loop活得更久，不能在析构函数中访问loop_
+    loop_->loadStats().connections.fetch_add(1, std::memory_order_relaxed);
     channel_->tie(shared_from_this());
-    channel_->enableReading();  // 注册读事件
+    updateReading();  // 注册读事件，建立前调用过stopRead或被背压暂停时不注册
+
+    if (idleTimeout_ > 0.0)
+    {
+        // 时间轮只持有weak_ptr，连接销毁后条目不会再访问该连接
+        idleEntry_ = loop_->timingWheel()->add(shared_from_this(), idleTimeout_,
+            std::bind(&TcpConnection::forceClose, this));
+    }
 
     connectionCallback_(shared_from_this()); // 执行连接回调
 }
@@ -167,24 +516,91 @@ void TcpConnection::connectDestroyed()
         channel_->disbaleAll();  // 注销所有channel的所有事件
         connectionCallback_(shared_from_this());
     }
+    if (idleEntry_ != nullptr)
+    {
+        loop_->timingWheel()->remove(idleEntry_);
+        idleEntry_ = nullptr;
+    }
+    closed_ = true;
+    if (backpressureActive_)
+    {
+        // 本连接不会再发送数据，恢复被暂停的源连接
+        backpressureActive_ = false;
+        TcpConnectionPtr source(heldSource_.lock());
+        if (source) source->releaseRead();
+    }
+    // 未发送的数据不会再发送，从loop的积压统计中扣除
+    metricSub(loop_->loopStats().outputBacklog, outputQueue_.readableBytes());
+    outputQueue_.retrieveAll();
+    loop_->loadStats().connections.fetch_sub(1, std::memory_order_relaxed);
     channel_->remove(); // 将TcpConnction的Channel从Poller中移除
 }
 
+void TcpConnection::recordWrite(size_t n)
+{
+    if (n == 0) return;
+    bytesSent_ += n;
+    EventLoop::LoopStats &stats = loop_->loopStats();
+    metricAdd(stats.writes);
+    metricAdd(stats.bytesWritten, n);
+}
+
 // 读取客户端发送过来的数据
+// 一次读事件中循环读取直到socket中没有数据，或者读取的字节数达到readBudget_，
+// 然后把本次读到的所有数据一次性交给messageCallback_
 void TcpConnection::handleRead(Timestamp receiveTime)
 {
+    // 边沿触发模式下读事件一直注册，停止读取期间的可读事件直接忽略，恢复时主动读取
+    // 也用于丢弃停止读取之前已经入队的续读任务
+    if (!channel_->isReading()) return;
+
+    EventLoop::ReadStats &stats = loop_->readStats();
+    EventLoop::ReadStats::increment(stats.events);
+
+    size_t total = 0;
     int savedErrno = 0;
-    ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
-    if (n > 0) // 有数据到达
+    ssize_t n = 0;
+    for (;;)
     {
+        size_t capacity = 0;
+        n = inputBuffer_.readFd(channel_->fd(), &savedErrno, readHint_,
+                                loop_->readOverflow(), EventLoop::kReadOverflowSize, &capacity);
+        if (n <= 0) break;
+
+        stats.record(n);
+        total += n;
+        adaptReadHint(n);
+        // 水平触发模式下没有读满readv的实际容量说明socket接收缓冲区已经读空，省去一次返回EAGAIN的系统调用
+        // 实际容量取决于inputBuffer_现有的可写空间，可能大于hint，也可能不包含溢出区
+        // 边沿触发模式下短读不能保证读空，必须读到EAGAIN，否则剩余数据不会再产生可读边沿
+        if (!channel_->edgeTriggered() && static_cast<size_t>(n) < capacity) break;
+        if (total >= readBudget_)
+        {
+            // 剩余数据留到下一轮，避免一个连接长时间占用loop
+            EventLoop::ReadStats::increment(stats.budgetExhausted);
+            if (channel_->edgeTriggered())
+            {
+                // 边沿触发模式下剩余数据不会再产生可读事件，需要主动继续读取
+                loop_->queueInLoop(
+                    std::bind(&TcpConnection::handleRead, shared_from_this(), receiveTime));
+            }
+            break;
+        }
+    }
+
+    if (total > 0) // 有数据到达
+    {
+        bytesReceived_ += total;
+        touchIdleEntry();
         // 数据处理回调函数
         messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
     }
-    else if (n == 0) // 客户端断开
+
+    if (n == 0) // 客户端断开
     {
         handleClose();
     }
-    else
+    else if (n < 0 && savedErrno != EAGAIN && savedErrno != EWOULDBLOCK)
     {
         errno = savedErrno;
         mylog::GetLogger("TcpConnection::handleRead");
@@ -192,37 +608,57 @@ void TcpConnection::handleRead(Timestamp receiveTime)
     }
 }
 
+// 根据每次readv读到的数据量调整下一次直接读入inputBuffer_的大小
+// 读满则翻倍，连续两次不足一半则减半，使小消息连接只占用小块内存，大消息连接减少从溢出区的拷贝
+void TcpConnection::adaptReadHint(size_t bytes)
+{
+    if (bytes >= readHint_)
+    {
+        readHint_ = std::min(readHint_ * 2, kMaxReadHint);
+        readShrinkCount_ = 0;
+    }
+    else if (bytes < readHint_ / 2)
+    {
+        if (++readShrinkCount_ >= 2)
+        {
+            readHint_ = std::max(readHint_ / 2, kMinReadHint);
+            readShrinkCount_ = 0;
+        }
+    }
+    else
+    {
+        readShrinkCount_ = 0;
+    }
+}
+
 void TcpConnection::handleWrite()
 {
     if (channel_->isWriting())
     {
-        int savedErrno = 0;
-        ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno);
-        if (n > 0)
+        // 一次可写事件中连续写出不同类型的数据段，如响应头之后紧接着发送文件，不需要等待下一次事件
+        bool budgetExhausted = false;
+        size_t written = drainOutput(&budgetExhausted);
+        if (closed_) return;
+
+        if (outputQueue_.empty())
         {
-            outputBuffer_.retrieve(n);
-            if (outputBuffer_.readableBytes() == 0)
-            {
-                channel_->disableWriting();
-                if (writeCompleteCallback_)
-                {
-                    // TcpConnection对象的channel也在loop_中，向其中加入回调任务
-                    loop_->queueInLoop(
-                        std::bind(writeCompleteCallback_, shared_from_this()));
-                }
-                if (state_ == kDisconnected)
-                {
-                    shutdownInLoop(); // 关闭TcpConnection
-                }
-            }
+            channel_->disableWriting();
+            outputDrained();
         }
-        else
+        else if (budgetExhausted && channel_->edgeTriggered())
+        {
+            // 发送缓冲区仍然可写但不会再有新的边沿，让出loop后继续发送
+            loop_->queueInLoop(
+                std::bind(&TcpConnection::handleWrite, shared_from_this()));
+        }
+        if (written > 0)
         {
-            mylog::GetLogger("asynclogger")->Error("TcpCOnnection::handleWrite");
+            touchIdleEntry();
         }
     }
-    else
+    else if (!channel_->edgeTriggered())
     {
+        // 边沿触发模式下可写事件一直注册，没有待发送数据时忽略即可
         mylog::GetLogger("asynclogger")->Error("TcpConnection fd=%d is down, no more writing", channel_->fd());
     }
 }
@@ -230,6 +666,8 @@ void TcpConnection::handleWrite()
 void TcpConnection::handleClose()
 {
     mylog::GetLogger("asynclogger")->Info("TcpConnection::handleClose fd=%d state=%d\n", channel_->fd(), (int)state_);
+    setState(kDisconnected);
+    closed_ = true;
     channel_->disbaleAll();
 
     TcpConnectionPtr connPtr(shared_from_this());
@@ -254,18 +692,20 @@ void TcpConnection::handleError()
 }
 
 // 发送文件，零拷贝操作
-void TcpConnection::sendFile(int fileDescriptor, off_t offset, size_t count)
+void TcpConnection::sendFile(int fileDescriptor, off_t offset, size_t count, std::shared_ptr<const void> owner)
 {
     if (connected())
     {
         if (loop_->isInLoopThread())
         {
-            sendFileInLoop(fileDescriptor, offset, count);
+            sendFileInLoop(fileDescriptor, offset, count, owner);
         }
         else // 如果调用该函数的线程与TcpConnection所在的线程不是同一个线程
         {
-            loop_->runInLoop(
-                std::bind(&TcpConnection::sendFileInLoop, shared_from_this(), fileDescriptor, offset, count));
+            TcpConnectionPtr self(shared_from_this());
+            loop_->runInLoop([self, fileDescriptor, offset, count, owner = std::move(owner)]() {
+                self->sendFileInLoop(fileDescriptor, offset, count, owner);
+            });
         }
     }
     else
@@ -274,47 +714,41 @@ void TcpConnection::sendFile(int fileDescriptor, off_t offset, size_t count)
     }
 }
 
-void TcpConnection::sendFileInLoop(int fileDescriptor, off_t offset, size_t count)
+void TcpConnection::sendFileInLoop(int fileDescriptor, off_t offset, size_t count, const std::shared_ptr<const void> &owner)
 {
-    ssize_t bytesSent = 0;
-    size_t remaining = count;
-    bool faultError = false;
-
     if (state_ == kDisconnected)
     {
-        mylog::GetLogger("asynclogger")->Error("disconnected, give ip writing");
+        mylog::GetLogger("asynclogger")->Error("disconnected, give up writing");
         return;
     }
+    if (count == 0) return;
 
-    if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
+    size_t nwrote = 0;
+    // 与writeDirectly相同，只有前面没有待发送数据时才能直接发送
+    if (!corked_ && !channel_->isWriting() && outputQueue_.readableBytes() == 0)
     {
-        bytesSent = sendfile(socket_->fd(), fileDescriptor, &offset, count);
-        if (bytesSent >= 0)
+        ssize_t n = ::sendfile(socket_->fd(), fileDescriptor, &offset, count);
+        int savedErrno = errno;  // 日志可能改写errno
+        if (n > 0)
         {
-            remaining -= bytesSent;
-            if (remaining == 0 && writeCompleteCallback_)
+            nwrote = static_cast<size_t>(n);
+            recordWrite(nwrote);
+            if (nwrote == count)
             {
-                loop_->queueInLoop(
-                    std::bind(writeCompleteCallback_, shared_from_this()));
+                notifyWriteComplete();
+                return;
             }
         }
-        else
+        else if (n < 0 && savedErrno != EAGAIN && savedErrno != EWOULDBLOCK)
         {
-            if (errno != EWOULDBLOCK)
-            {
-                mylog::GetLogger("asynclogger")->Error("TcpConnection::sendFileInLoop");
-            }
-            if (errno == EPIPE || errno == ECONNRESET)
-            {
-                faultError = true;
-            }
+            mylog::GetLogger("asynclogger")->Error("TcpConnection::sendFileInLoop error: %s", strerror(savedErrno));
+            if (savedErrno == EPIPE || savedErrno == ECONNRESET) return;
+            // 其他错误（如fd不支持sendfile）交给drainOutput，文件数据段出错时关闭连接
         }
     }
 
-    if (!faultError && remaining > 0)
-    {
-        // 继续发送剩余部分
-        loop_->queueInLoop(
-            std::bind(&TcpConnection::sendFileInLoop, shared_from_this(), fileDescriptor, offset, count));
-    }
-}
\ No newline at end of file
+    // 剩余部分作为文件数据段进入输出队列，sendfile已经推进了offset，等待可写事件后从断点继续发送
+    size_t oldLen = outputQueue_.readableBytes();
+    outputQueue_.appendFile(fileDescriptor, offset, count - nwrote, owner);
+    queueOutput(oldLen);
+}
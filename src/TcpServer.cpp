@@ -1,4 +1,5 @@
 #include <functional>
+#include <future>
 #include <string.h>
 #include "TcpServer.hpp"
 #include "TcpConnection.hpp"
@@ -18,6 +19,7 @@ TcpServer::TcpServer(EventLoop* loop,
                      const std::string &nameArg,
                      Option option)
     : loop_(CheckLoopNotNull(loop)),
+      listenAddr_(listenAddr),
       ipPort_(listenAddr.toIpPort()),
       name_(nameArg),
       acceptor_(new Acceptor(loop, listenAddr, option == KReusePort)),
@@ -25,22 +27,50 @@ TcpServer::TcpServer(EventLoop* loop,
       connectionCallback_(),
       messageCallback_(),
       nextConnId_(1),
+      idleTimeout_(0.0),
+      readBudget_(TcpConnection::kDefaultReadBudget),
+      edgeTriggered_(false),
+      backpressureHigh_(0),
+      backpressureLow_(0),
+      acceptMode_(kSingleAcceptor),
+      acceptBatch_(Acceptor::kDefaultAcceptBatch),
       started_(0)
 {
     // 有新用户连接时，Acceptor类中绑定的acceptChannel_会有读事件发生，
-    //handleRead()实际调用了TcpServer::newConnection
-    acceptor_->setNewConnectionCallback(
-            std::bind(&TcpServer::newConnection, this, std::placeholders::_1, std::placeholders::_2));
+    //handleRead()实际调用了TcpServer::newConnections
+    acceptor_->setNewConnectionBatchCallback(
+            std::bind(&TcpServer::newConnections, this, nullptr, std::placeholders::_1));
 }
 
 TcpServer::~TcpServer()
 {
-    for (auto &item : connections_)
+    // subloop中的Acceptor回调持有this，必须等它们在各自的loop中销毁后才能返回
+    for (auto &item : shards_)
     {
-        TcpConnectionPtr conn(item.second);
-        item.second.reset(); // 释放item中指向TcpConnection的智能指针
-        conn->getLoop()->runInLoop(
-            std::bind(&TcpConnection::connectDestroyed, conn));
+        ConnectionShardPtr shard(item.second);
+        if (!shard->acceptor) continue;
+        std::promise<void> done;
+        shard->loop->runInLoop([shard, &done]
+        {
+            shard->acceptor.reset();
+            done.set_value();
+        });
+        done.get_future().wait();
+    }
+
+    // 连接表只能在所属的loop中访问，由各个loop销毁自己的连接
+    for (auto &item : shards_)
+    {
+        ConnectionShardPtr shard(item.second);
+        shard->loop->runInLoop([shard]
+        {
+            for (auto &conn : shard->connections)
+            {
+                conn.second->connectDestroyed();
+            }
+            shard->connections.clear();
+            shard->count.store(0, std::memory_order_relaxed);
+        });
     }
 }
 
@@ -58,14 +88,106 @@ void TcpServer::start()
     if (started_.fetch_add(1) == 0)
     {
         threadPool_->start(threadInitCallback_);    // 启动底层的loop线程池
-        loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
+        for (EventLoop *ioLoop : threadPool_->getAllLoops())
+        {
+            shards_[ioLoop] = std::make_shared<ConnectionShard>(ioLoop);
+        }
+        if (acceptMode_ == kSingleAcceptor)
+        {
+            acceptor_->setAcceptBatch(acceptBatch_);
+            acceptStats_.push_back(acceptor_->stats());
+            loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
+        }
+        else
+        {
+            startLoopAcceptors();
+        }
+    }
+}
+
+void TcpServer::startLoopAcceptors()
+{
+    std::shared_ptr<Socket> sharedSocket;
+    if (acceptMode_ == kReusePortPerLoop)
+    {
+        // baseLoop的监听socket未设置SO_REUSEPORT时会占用端口，先关闭
+        acceptor_.reset();
+    }
+    else
+    {
+        // 共享baseLoop中已绑定的监听socket，baseLoop自身不监听
+        sharedSocket = acceptor_->socket();
+    }
+
+    for (auto &item : shards_)
+    {
+        EventLoop *ioLoop = item.first;
+        ConnectionShard *shard = item.second.get();
+        if (acceptMode_ == kReusePortPerLoop)
+        {
+            shard->acceptor.reset(new Acceptor(ioLoop, listenAddr_, true));
+        }
+        else
+        {
+            shard->acceptor.reset(new Acceptor(ioLoop, sharedSocket));
+            shard->acceptor->setExclusive(true);
+        }
+        shard->acceptor->setAcceptBatch(acceptBatch_);
+        acceptStats_.push_back(shard->acceptor->stats());
+        shard->acceptor->setNewConnectionBatchCallback(
+            std::bind(&TcpServer::newConnections, this, ioLoop, std::placeholders::_1));
+        ioLoop->runInLoop(std::bind(&Acceptor::listen, shard->acceptor.get()));
     }
 }
 
 // acceptor处理新连接的回调函数
-void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
+void TcpServer::newConnections(EventLoop *ioLoop, const Acceptor::AcceptedList &accepted)
+{
+    // 连接在subloop中建立之前先计入所选loop的pendingConnections，同一批中后面的选择能看到前面的分配
+    // 按subloop分组，subloop数量很少，线性查找即可
+    std::vector<std::pair<EventLoop *, std::vector<TcpConnectionPtr>>> groups;
+    for (const Acceptor::AcceptedConnection &item : accepted)
+    {
+        EventLoop *target = ioLoop != nullptr ? ioLoop : threadPool_->getNextLoop(item.peerAddr);
+        target->loadStats().pendingConnections.fetch_add(1, std::memory_order_relaxed);
+        auto it = groups.begin();
+        while (it != groups.end() && it->first != target) ++it;
+        if (it == groups.end())
+        {
+            groups.emplace_back(target, std::vector<TcpConnectionPtr>());
+            it = groups.end() - 1;
+        }
+        it->second.push_back(createConnection(target, item.sockfd, item.peerAddr));
+    }
+
+    // 连接在所属的subloop中登记，baseLoop只负责accept
+    for (auto &group : groups)
+    {
+        ConnectionShardPtr shard(shardOf(group.first));
+        group.first->runInLoop([shard, conns = std::move(group.second)]
+        {
+            establishConnections(shard, conns);
+        });
+    }
+}
+
+void TcpServer::establishConnections(const ConnectionShardPtr &shard, const std::vector<TcpConnectionPtr> &conns)
+{
+    for (const TcpConnectionPtr &conn : conns)
+    {
+        shard->connections[conn->name()] = conn;
+    }
+    shard->count.store(shard->connections.size(), std::memory_order_relaxed);
+    for (const TcpConnectionPtr &conn : conns)
+    {
+        conn->connectEstablished();
+        // connectEstablished已经计入connections
+        conn->getLoop()->loadStats().pendingConnections.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+TcpConnectionPtr TcpServer::createConnection(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr)
 {
-    EventLoop *ioLoop = threadPool_->getNextLoop();
     std::string connName = name_ + "-" + ipPort_ + std::to_string(nextConnId_++);
 
     mylog::GetLogger("asynclogger")->Info("TcpServer::newConnection [%s] - new connection [%s] from %s\n",
@@ -81,27 +203,79 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
     }
     InetAddress localAddr(local);
     TcpConnectionPtr conn(new TcpConnection(ioLoop, connName, sockfd, localAddr, peerAddr));
-    connections_[connName] = conn;
 
     conn->setConnectionCallback(connectionCallback_);
     conn->setMessageCallback(messageCallback_);
     conn->setWriteCompleteCallback(writeCompleteCallback_);
+    conn->setIdleTimeout(idleTimeout_);
+    conn->setReadBudget(readBudget_);
+    conn->setEdgeTriggered(edgeTriggered_);
+    conn->setBackpressure(backpressureHigh_, backpressureLow_);
+
+    conn->setCloseCallback(std::bind(&TcpServer::removeConnection,
+                                     std::weak_ptr<ConnectionShard>(shardOf(ioLoop)), std::placeholders::_1));
+    return conn;
+}
+
+void TcpServer::removeConnection(const std::weak_ptr<ConnectionShard> &weakShard, const TcpConnectionPtr &conn)
+{
+    mylog::GetLogger("asynclogger")->Info("TcpServer::removeConnection - connection %s\n", conn->name().c_str());
+    ConnectionShardPtr shard(weakShard.lock());
+    if (shard)
+    {
+        shard->connections.erase(conn->name());
+        shard->count.store(shard->connections.size(), std::memory_order_relaxed);
+    }
+    // 当前仍在Channel的事件处理中，Channel的销毁需要放到本轮事件处理之后
+    conn->getLoop()->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+}
+
+const TcpServer::ConnectionShardPtr &TcpServer::shardOf(EventLoop *loop) const
+{
+    return shards_.at(loop);
+}
+
+size_t TcpServer::numConnections() const
+{
+    size_t total = 0;
+    for (auto &item : shards_)
+    {
+        total += item.second->count.load(std::memory_order_relaxed);
+    }
+    return total;
+}
 
-    conn->setCloseCallback(std::bind(&TcpServer::removeConnection, this, std::placeholders::_1));
-    ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+std::vector<EventLoop*> TcpServer::loops() const
+{
+    return threadPool_->getAllLoops();
 }
 
-void TcpServer::removeConnection(const TcpConnectionPtr &conn)
+TcpServer::AcceptTotals TcpServer::acceptTotals() const
 {
-    loop_->runInLoop(
-        std::bind(&TcpServer::removeConnectionInLoop, this, conn));
+    AcceptTotals totals = {0, 0, 0, 0};
+    for (auto &stats : acceptStats_)
+    {
+        totals.accepted += stats->accepted.load(std::memory_order_relaxed);
+        totals.shed += stats->shed.load(std::memory_order_relaxed);
+        totals.errors += stats->errors.load(std::memory_order_relaxed);
+        totals.batches += stats->batches.load(std::memory_order_relaxed);
+    }
+    return totals;
 }
 
-void TcpServer::removeConnectionInLoop(const TcpConnectionPtr &conn)
+void TcpServer::forEachConnection(const std::function<void(const TcpConnectionPtr &)> &cb)
 {
-    mylog::GetLogger("asynclogger")->Info("TcpServer::removeConnectionInLoop [%s] - connection %s\n",
-            name_.c_str(), conn->name().c_str());
-    connections_.erase(conn->name());
-    EventLoop *ioLoop = conn->getLoop();
-    ioLoop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+    // 所有loop共享同一份回调
+    auto sharedCb = std::make_shared<std::function<void(const TcpConnectionPtr &)>>(cb);
+    for (auto &item : shards_)
+    {
+        ConnectionShardPtr shard(item.second);
+        shard->loop->runInLoop([shard, sharedCb]
+        {
+            for (auto &conn : shard->connections)
+            {
+                (*sharedCb)(conn.second);
+            }
+        });
+    }
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "Thread.hpp"
 #include "CurrentThread.hpp"
 #include <semaphore.h> // 信号量
+#include <pthread.h>
 
 std::atomic_int Thread::numCreated_(0);
 
@@ -28,6 +29,8 @@ void Thread::start()
 
     thread_ = std::make_shared<std::thread>([&](){
         tid_ = CurrentThread::tid();
+        // 线程名供top、perf等工具显示，内核限制为15个字符
+        pthread_setname_np(pthread_self(), name_.substr(0, 15).c_str());
         sem_post(&sem);
         func_();
     });
@@ -1,26 +1,65 @@
 #include "Timestamp.hpp"
 #include <ctime>
+#include <cstdio>
 
-Timestamp::Timestamp() : secondsSinceEopch_(0) {}
+Timestamp::Timestamp() : microSecondsSinceEpoch_(0) {}
 
-Timestamp::Timestamp(int64_t secondsSinceEopch)
-    : secondsSinceEopch_(secondsSinceEopch) {}
+Timestamp::Timestamp(int64_t microSecondsSinceEpoch)
+    : microSecondsSinceEpoch_(microSecondsSinceEpoch) {}
 
 Timestamp Timestamp::now()
 {
-    return Timestamp(time(NULL));
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return Timestamp(static_cast<int64_t>(ts.tv_sec) * kMicroSecondsPerSecond + ts.tv_nsec / 1000);
+}
+
+Duration Timestamp::monotonic()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return Duration(static_cast<int64_t>(ts.tv_sec) * 1000 * 1000 * 1000 + ts.tv_nsec);
+}
+
+// 每个线程缓存最近一次格式化的秒，同一秒内的时间戳只需要拼接微秒部分
+namespace
+{
+thread_local time_t t_lastSecond = -1;
+thread_local char t_secondString[64];
+
+const char *formatSecond(time_t seconds)
+{
+    if (seconds != t_lastSecond)
+    {
+        tm tm_time;
+        localtime_r(&seconds, &tm_time); // 转化为本地时间，可重入
+        snprintf(t_secondString, sizeof(t_secondString), "%04d/%02d/%02d %02d:%02d:%02d",
+                 tm_time.tm_year + 1900,
+                 tm_time.tm_mon + 1,
+                 tm_time.tm_mday,
+                 tm_time.tm_hour,
+                 tm_time.tm_min,
+                 tm_time.tm_sec);
+        t_lastSecond = seconds;
+    }
+    return t_secondString;
+}
 }
 
 std::string Timestamp::toString() const
 {
-    char buf[128] = {0};
-    tm *tm_time = localtime(&secondsSinceEopch_); // 转化为本地时间
-    snprintf(buf, 128, "%04d/%02d/%02d %02d:%02d:%02d",
-             tm_time->tm_year + 1900,
-             tm_time->tm_mon + 1,
-             tm_time->tm_mday,
-             tm_time->tm_hour,
-             tm_time->tm_min,
-             tm_time->tm_sec);
+    return toFormattedString(false);
+}
+
+std::string Timestamp::toFormattedString(bool showMicroseconds) const
+{
+    const char *second = formatSecond(secondsSinceEpoch());
+    if (!showMicroseconds)
+    {
+        return std::string(second);
+    }
+    char buf[96];
+    int microseconds = static_cast<int>(microSecondsSinceEpoch_ % kMicroSecondsPerSecond);
+    snprintf(buf, sizeof(buf), "%s.%06d", second, microseconds);
     return std::string(buf);
-}
\ No newline at end of file
+}
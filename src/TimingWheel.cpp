@@ -0,0 +1,151 @@
+#include <cmath>
+#include "TimingWheel.hpp"
+#include "EventLoop.hpp"
+#include "MyLog.hpp"
+
+TimingWheel::TimingWheel(EventLoop *loop, double tickSeconds, size_t numBuckets)
+    : loop_(loop),
+      tickSeconds_(tickSeconds),
+      mask_(numBuckets - 1),
+      buckets_(numBuckets),
+      currentTick_(0),
+      size_(0),
+      linkedCount_(0),
+      ticking_(false)
+{
+    if (numBuckets == 0 || (numBuckets & mask_) != 0)
+    {
+        mylog::GetLogger("asynclogger")->Fatal("TimingWheel numBuckets %lu is not a power of 2", numBuckets);
+    }
+    for (Entry &head : buckets_)
+    {
+        head.prev = head.next = &head;
+        head.linked = false;
+    }
+}
+
+TimingWheel::~TimingWheel()
+{
+    if (ticking_)
+    {
+        loop_->cancel(tickTimer_);
+    }
+    for (Entry &head : buckets_)
+    {
+        Entry *entry = head.next;
+        while (entry != &head)
+        {
+            Entry *next = entry->next;
+            delete entry;
+            entry = next;
+        }
+    }
+}
+
+TimingWheel::Entry *TimingWheel::add(const std::shared_ptr<void> &tie, double timeout, ExpireCallback cb)
+{
+    Entry *entry = new Entry;
+    entry->prev = entry->next = nullptr;
+    entry->timeoutTicks = std::max<int64_t>(1, static_cast<int64_t>(std::ceil(timeout / tickSeconds_)));
+    entry->deadline = currentTick_ + entry->timeoutTicks;
+    entry->linked = false;
+    entry->tie = tie;
+    entry->callback = std::move(cb);
+    ++size_;
+    link(entry);
+    return entry;
+}
+
+void TimingWheel::remove(Entry *entry)
+{
+    if (entry->linked) unlink(entry);
+    --size_;
+    delete entry;
+}
+
+void TimingWheel::link(Entry *entry)
+{
+    Entry &head = buckets_[entry->deadline & mask_];
+    entry->prev = head.prev;
+    entry->next = &head;
+    head.prev->next = entry;
+    head.prev = entry;
+    entry->linked = true;
+
+    // 时间轮从空变为非空时启动tick定时器
+    if (++linkedCount_ == 1 && !ticking_)
+    {
+        ticking_ = true;
+        tickTimer_ = loop_->runEvery(tickSeconds_, std::bind(&TimingWheel::onTick, this));
+    }
+}
+
+void TimingWheel::unlink(Entry *entry)
+{
+    entry->prev->next = entry->next;
+    entry->next->prev = entry->prev;
+    entry->prev = entry->next = nullptr;
+    entry->linked = false;
+    --linkedCount_;
+}
+
+void TimingWheel::onTick()
+{
+    ++currentTick_;
+    Entry &head = buckets_[currentTick_ & mask_];
+
+    // 先把当前槽位整体摘下，避免回调或重新挂载修改正在遍历的链表
+    Entry *entry = nullptr;
+    if (head.next != &head)
+    {
+        entry = head.next;
+        head.prev->next = nullptr;
+        head.prev = head.next = &head;
+    }
+
+    std::vector<Entry*> expired;
+    while (entry != nullptr)
+    {
+        Entry *next = entry->next;
+        entry->linked = false;
+        --linkedCount_;
+        if (entry->deadline > currentTick_)
+        {
+            // 到期时间在之后的轮次，或在此期间被刷新过，挂到新的槽位
+            link(entry);
+        }
+        else
+        {
+            entry->prev = entry->next = nullptr;
+            expired.push_back(entry);
+        }
+        entry = next;
+    }
+
+    // 先锁住所有到期条目的所属对象再执行回调，回调中删除其他条目不会影响遍历
+    std::vector<std::pair<std::shared_ptr<void>, ExpireCallback>> callbacks;
+    for (Entry *e : expired)
+    {
+        std::shared_ptr<void> guard = e->tie.lock();
+        if (guard)
+        {
+            callbacks.emplace_back(std::move(guard), e->callback);
+        }
+        else
+        {
+            // 所属对象已经销毁且没有删除条目，由时间轮回收
+            --size_;
+            delete e;
+        }
+    }
+    for (auto &cb : callbacks)
+    {
+        cb.second();
+    }
+
+    if (linkedCount_ == 0 && ticking_)
+    {
+        ticking_ = false;
+        loop_->cancel(tickTimer_);
+    }
+}
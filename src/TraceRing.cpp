@@ -0,0 +1,198 @@
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include "TraceRing.hpp"
+#include "Timestamp.hpp"
+
+namespace
+{
+// 存活的跟踪环，供dumpAll和崩溃处理函数遍历，登记和注销都不加锁
+const int kMaxRings = 256;
+std::atomic<TraceRing *> g_rings[kMaxRings];
+
+int g_crashFd = 2;
+
+bool envEnabled()
+{
+    const char *env = ::getenv("MUDUO_TRACE");
+    return env != nullptr && env[0] != '\0' && env[0] != '0';
+}
+
+// 只使用write，可以在信号处理函数中调用
+void writeAll(int fd, const char *buf, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = ::write(fd, buf, len);
+        if (n <= 0) return;
+        buf += n;
+        len -= static_cast<size_t>(n);
+    }
+}
+
+// 把非负整数以base进制追加到p，返回新的末尾
+char *appendNumber(char *p, uint64_t value, unsigned base)
+{
+    char tmp[24];
+    int len = 0;
+    do
+    {
+        tmp[len++] = "0123456789abcdef"[value % base];
+        value /= base;
+    } while (value != 0);
+    while (len > 0) *p++ = tmp[--len];
+    return p;
+}
+
+char *appendString(char *p, const char *s)
+{
+    while (*s != '\0') *p++ = *s++;
+    return p;
+}
+
+void crashHandler(int sig)
+{
+    TraceRing::dumpAll(g_crashFd);
+    ::raise(sig); // SA_RESETHAND已恢复默认处理方式
+}
+}
+
+std::atomic<bool> TraceRing::enabled_(envEnabled());
+
+TraceRing::TraceRing()
+    : slots_(new Slot[kCapacity]),
+      next_(0),
+      registryIndex_(-1)
+{
+    static_assert((kCapacity & (kCapacity - 1)) == 0, "TraceRing capacity must be a power of two");
+    for (int i = 0; i < kMaxRings; ++i)
+    {
+        TraceRing *expected = nullptr;
+        if (g_rings[i].compare_exchange_strong(expected, this))
+        {
+            registryIndex_ = i;
+            break;
+        }
+    }
+}
+
+TraceRing::~TraceRing()
+{
+    if (registryIndex_ >= 0)
+    {
+        g_rings[registryIndex_].store(nullptr);
+    }
+}
+
+void TraceRing::append(Op op, int fd, uint32_t events)
+{
+    uint64_t seq = next_.load(std::memory_order_relaxed);
+    Slot &slot = slots_[seq & (kCapacity - 1)];
+    // 与read中的acquire fence配对：读者读到本次写入的字段时，一定能看到next_已经越过被覆盖的序号
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.nanoseconds.store(Timestamp::monotonic().nanoseconds(), std::memory_order_relaxed);
+    slot.fdAndEvents.store(static_cast<uint64_t>(static_cast<uint32_t>(fd)) << 32 | events, std::memory_order_relaxed);
+    slot.op.store(op, std::memory_order_relaxed);
+    next_.store(seq + 1, std::memory_order_release);
+}
+
+bool TraceRing::read(uint64_t seq, Record *record) const
+{
+    const Slot &slot = slots_[seq & (kCapacity - 1)];
+    record->nanoseconds = slot.nanoseconds.load(std::memory_order_relaxed);
+    uint64_t fdAndEvents = slot.fdAndEvents.load(std::memory_order_relaxed);
+    record->op = static_cast<Op>(slot.op.load(std::memory_order_relaxed));
+    record->fd = static_cast<int>(fdAndEvents >> 32);
+    record->events = static_cast<uint32_t>(fdAndEvents);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // 写者正在写或已经写过seq + kCapacity时，该位置的内容不再属于seq
+    return next_.load(std::memory_order_relaxed) < seq + kCapacity;
+}
+
+std::vector<TraceRing::Record> TraceRing::snapshot() const
+{
+    std::vector<Record> records;
+    uint64_t end = next_.load(std::memory_order_acquire);
+    uint64_t begin = end > kCapacity ? end - kCapacity : 0;
+    records.reserve(end - begin);
+    for (uint64_t seq = begin; seq < end; ++seq)
+    {
+        Record record;
+        if (read(seq, &record)) records.push_back(record);
+    }
+    return records;
+}
+
+// 每条记录一行：纳秒时间戳 操作 fd=N events=0x...
+void TraceRing::dump(int fd) const
+{
+    char line[128];
+    char *p = appendString(line, "trace ring ");
+    p = appendNumber(p, reinterpret_cast<uintptr_t>(this), 16);
+    *p++ = '\n';
+    writeAll(fd, line, p - line);
+
+    uint64_t end = next_.load(std::memory_order_acquire);
+    uint64_t begin = end > kCapacity ? end - kCapacity : 0;
+    for (uint64_t seq = begin; seq < end; ++seq)
+    {
+        Record record;
+        if (!read(seq, &record)) continue;
+        p = appendNumber(line, static_cast<uint64_t>(record.nanoseconds), 10);
+        *p++ = ' ';
+        p = appendString(p, opName(record.op));
+        p = appendString(p, " fd=");
+        if (record.fd < 0)
+        {
+            *p++ = '-';
+            p = appendNumber(p, static_cast<uint64_t>(-static_cast<int64_t>(record.fd)), 10);
+        }
+        else
+        {
+            p = appendNumber(p, static_cast<uint64_t>(record.fd), 10);
+        }
+        p = appendString(p, " events=0x");
+        p = appendNumber(p, record.events, 16);
+        *p++ = '\n';
+        writeAll(fd, line, p - line);
+    }
+}
+
+void TraceRing::dumpAll(int fd)
+{
+    for (int i = 0; i < kMaxRings; ++i)
+    {
+        TraceRing *ring = g_rings[i].load();
+        if (ring != nullptr) ring->dump(fd);
+    }
+}
+
+void TraceRing::installCrashHandler(int fd)
+{
+    g_crashFd = fd;
+    const int signals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+    for (int sig : signals)
+    {
+        struct sigaction sa;
+        ::memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = crashHandler;
+        sigemptyset(&sa.sa_mask);
+        sa.sa_flags = SA_RESETHAND;
+        ::sigaction(sig, &sa, nullptr);
+    }
+}
+
+const char *TraceRing::opName(Op op)
+{
+    switch (op)
+    {
+    case kEvent: return "event";
+    case kAdd: return "add";
+    case kMod: return "mod";
+    case kDel: return "del";
+    case kUpdate: return "update";
+    case kRemove: return "remove";
+    }
+    return "unknown";
+}
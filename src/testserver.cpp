@@ -46,8 +46,7 @@ private:
     // 可读写事件回调
     void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp time)
     {
-        std::string msg = buf->retrieveAllAsString();
-        conn->send(msg);
+        conn->send(buf); // 直接发送Buffer中的数据，不产生临时string
         // conn->shutdown();   // 关闭写端 底层响应EPOLLHUP => 执行closeCallback_
     }
     TcpServer server_;